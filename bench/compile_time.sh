@@ -0,0 +1,142 @@
+#!/usr/bin/env bash
+#
+# Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+#
+# Measures compile time and object size for a project of generated models, built in two modes:
+#  - inline: models are declared with PROVIDE_DETAILS in a header which includes json_model/model.h
+#  - define: models are declared with JSON_MODEL_DECLARE in a header which includes json_model/fwd.h, and defined with
+#    JSON_MODEL_DEFINE in separate translation units
+# Each mode has the same consumer translation units, which construct and modify models. In define mode, only the
+# translation unit which serializes models includes json_model/model.h
+#
+# Usage: compile_time.sh <compiler> <include dir> <work dir> [models] [consumers] [models per definition unit]
+
+set -euo pipefail
+
+CXX=${1:?compiler}
+INCLUDE_DIR=${2:?include dir}
+WORK_DIR=${3:?work dir}
+MODELS=${4:-50}
+CONSUMERS=${5:-10}
+MODELS_PER_UNIT=${6:-25}
+CXX_FLAGS=(-std=c++17 -O2 -I"$INCLUDE_DIR" -I"$WORK_DIR")
+
+rm -rf "$WORK_DIR"
+mkdir -p "$WORK_DIR/inline" "$WORK_DIR/define"
+
+# Model i has a few primitive fields and nests vector of model i - 1, so the whole template tree is instantiated
+fields() {
+    local i=$1
+    echo "    DECLARE_FIELD(id, int64_t);"
+    echo "    DECLARE_FIELD(name, std::string);"
+    echo "    DECLARE_FIELD(price, double);"
+    echo "    DECLARE_FIELD(tags, std::map<std::string, std::string>);"
+    echo "    DECLARE_FIELD(comment, std::optional<std::string>);"
+    if [ "$i" -gt 0 ]; then
+        echo "    DECLARE_FIELD(children, std::vector<std::unique_ptr<Model$((i - 1))>>);"
+    fi
+}
+
+details() {
+    local i=$1
+    echo "    Model$i,"
+    echo "    id(_, \"id\"),"
+    echo "    name(_, \"name\"),"
+    echo "    price(_, \"price\"),"
+    echo "    tags(_, \"tags\"),"
+    if [ "$i" -gt 0 ]; then
+        echo "    comment(_, \"comment\"),"
+        echo "    children(_, \"children\")"
+    else
+        echo "    comment(_, \"comment\")"
+    fi
+}
+
+generate() {
+    local mode=$1
+    local dir="$WORK_DIR/$mode"
+    {
+        echo "#pragma once"
+        if [ "$mode" = inline ]; then
+            echo "#include <json_model/model.h>"
+        else
+            echo "#include <json_model/fwd.h>"
+        fi
+        echo "namespace bench {"
+        for ((i = 0; i < MODELS; ++i)); do
+            echo "struct Model$i : public json_model::Model {"
+            fields "$i"
+            if [ "$mode" = inline ]; then
+                echo "    PROVIDE_DETAILS("
+                details "$i"
+                echo "    )"
+            else
+                echo "    JSON_MODEL_DECLARE(Model$i)"
+            fi
+            echo "};"
+        done
+        echo "} // namespace bench"
+    } > "$dir/models.h"
+
+    if [ "$mode" = define ]; then
+        for ((begin = 0; begin < MODELS; begin += MODELS_PER_UNIT)); do
+            {
+                echo "#include \"define/models.h\""
+                echo "#include <json_model/model.h>"
+                echo "namespace bench {"
+                for ((i = begin; i < MODELS && i < begin + MODELS_PER_UNIT; ++i)); do
+                    echo "JSON_MODEL_DEFINE("
+                    details "$i"
+                    echo ");"
+                done
+                echo "} // namespace bench"
+            } > "$dir/define_$begin.cpp"
+        done
+    fi
+
+    for ((c = 0; c < CONSUMERS; ++c)); do
+        {
+            echo "#include \"$mode/models.h\""
+            if [ "$c" -eq 0 ]; then
+                echo "#include <json_model/model.h>"
+            fi
+            echo "#include <string>"
+            echo "std::string consumer_$c() {"
+            echo "    std::string result;"
+            for ((i = c; i < MODELS; i += CONSUMERS)); do
+                echo "    { bench::Model$i model; model.set_id($i); model.set_name(\"name\"); result += model.get_name(); }"
+            done
+            if [ "$c" -eq 0 ]; then
+                echo "    bench::Model$((MODELS - 1)) root;"
+                echo "    result += root.to_json();"
+            fi
+            echo "    return result;"
+            echo "}"
+        } > "$dir/consumer_$c.cpp"
+    done
+}
+
+now_ms() {
+    echo $(($(date +%s%N) / 1000000))
+}
+
+measure() {
+    local mode=$1
+    local dir="$WORK_DIR/$mode"
+    local start
+    start=$(now_ms)
+    for source in "$dir"/*.cpp; do
+        "$CXX" "${CXX_FLAGS[@]}" -c "$source" -o "${source%.cpp}.o"
+    done
+    local elapsed=$(($(now_ms) - start))
+    local size
+    size=$(cat "$dir"/*.o | wc -c)
+    local units
+    units=$(ls "$dir"/*.cpp | wc -l)
+    printf "%-8s %6d models %4d units %10d ms %12d object bytes\n" "$mode" "$MODELS" "$units" "$elapsed" "$size"
+}
+
+generate inline
+generate define
+measure inline
+measure define
@@ -0,0 +1,154 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_ATOMIC_MODEL_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_ATOMIC_MODEL_H
+
+#include "model.h"
+#include "traits.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace json_model {
+
+// Holder of an immutable model, which is read by many threads and replaced as a whole, e.g. configuration which is
+// reloaded periodically. Readers get const model through a guard with a fixed number of atomic operations, without
+// locks and retries. Writers publish new version with atomic pointer swap, then wait until readers of the old version
+// are gone and take it back. Readers are counted in sharded counters of two epochs, so that new readers don't delay
+// the writer and readers on different threads rarely touch the same cache line
+template<typename M>
+class AtomicModel {
+    static_assert(is_model_v<M>);
+
+    static constexpr size_t SLOT_COUNT = 64;
+
+    struct alignas(64) Slot {
+        std::atomic<size_t> readers[2] = {0, 0};
+    };
+
+public:
+    // Keeps version of model alive while it exists. Guards must be short-lived, as writers wait for them, and must not
+    // be held by the thread which publishes new version
+    class ReadGuard {
+    public:
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+
+        ReadGuard(ReadGuard&& other) noexcept
+            : counter_(std::exchange(other.counter_, nullptr)), model_(std::exchange(other.model_, nullptr)) {}
+
+        ReadGuard& operator=(ReadGuard&&) = delete;
+
+        ~ReadGuard() noexcept {
+            if (counter_ != nullptr) {
+                counter_->fetch_sub(1);
+            }
+        }
+
+        const M* get() const noexcept {
+            return model_;
+        }
+
+        const M& operator*() const noexcept {
+            assert(model_);
+            return *model_;
+        }
+
+        const M* operator->() const noexcept {
+            assert(model_);
+            return model_;
+        }
+
+    private:
+        friend class AtomicModel;
+
+        ReadGuard(std::atomic<size_t>* counter, const M* model) noexcept: counter_(counter), model_(model) {}
+
+        std::atomic<size_t>* counter_;
+        const M* model_;
+    };
+
+    AtomicModel() noexcept: AtomicModel(std::make_unique<M>()) {}
+
+    explicit AtomicModel(std::unique_ptr<M> model) noexcept: current_(model.release()), epoch_(0) {
+        assert(current_.load() != nullptr);
+    }
+
+    AtomicModel(const AtomicModel&) = delete;
+    AtomicModel& operator=(const AtomicModel&) = delete;
+
+    // There must be no readers
+    ~AtomicModel() noexcept {
+        delete current_.load();
+    }
+
+    [[nodiscard]] ReadGuard read() const noexcept {
+        std::atomic<size_t>& counter = get_slot().readers[epoch_.load() & 1];
+        counter.fetch_add(1);
+        // Version is loaded after the reader is counted, so a writer which replaced it before will wait for the reader
+        return ReadGuard(&counter, current_.load());
+    }
+
+    // Publishes new version and returns the previous one once no reader can access it. Writers are serialized
+    std::unique_ptr<M> publish(std::unique_ptr<M> model) noexcept {
+        assert(model);
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        return publish_locked(std::move(model));
+    }
+
+    // Parses new version off the read path and publishes it. Model of the version replaced by the previous reload is
+    // reused for parsing, so steady reloads don't reallocate storage. On error current version is kept, and
+    // json_model::Exception is thrown or false returned
+    bool reload(const std::string& json_str, bool throw_on_error = true) {
+        std::lock_guard<std::mutex> lock(write_mutex_);
+        if (!spare_) {
+            spare_ = std::make_unique<M>();
+        }
+        if (!spare_->from_json(json_str, throw_on_error)) {
+            return false;
+        }
+        spare_ = publish_locked(std::move(spare_));
+        return true;
+    }
+
+private:
+    // Threads are spread over slots once, in order of their first read
+    Slot& get_slot() const noexcept {
+        static std::atomic<size_t> next_index(0);
+        thread_local size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % SLOT_COUNT;
+        return slots_[index];
+    }
+
+    std::unique_ptr<M> publish_locked(std::unique_ptr<M> model) noexcept {
+        std::unique_ptr<M> previous(current_.exchange(model.release()));
+        // Reader of the previous version is counted in one of epochs, which are drained in turn. New readers go to the
+        // other epoch, so that each one is drained in bounded time
+        for (int i = 0; i < 2; ++i) {
+            size_t drained = epoch_.fetch_add(1) & 1;
+            for (const Slot& slot : slots_) {
+                while (slot.readers[drained].load() != 0) {
+                    std::this_thread::yield();
+                }
+            }
+        }
+        return previous;
+    }
+
+    std::atomic<M*> current_;
+    std::atomic<size_t> epoch_;
+    mutable Slot slots_[SLOT_COUNT];
+    std::mutex write_mutex_;
+    std::unique_ptr<M> spare_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_ATOMIC_MODEL_H
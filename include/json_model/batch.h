@@ -0,0 +1,247 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_BATCH_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_BATCH_H
+
+#include "model.h"
+#include "error.h"
+#include "from_json.h"
+#include "init.h"
+#include "parse_context.h"
+#include "stream.h"
+#include "thread_pool.h"
+#include "traits.h"
+#include "types.h"
+#include "value.h"
+
+#include "external/rapidjson/document.h"
+#include "external/rapidjson/error/en.h"
+
+#include <algorithm>
+#include <cassert>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace json_model {
+
+// Elements of ranges below may be models or (smart) pointers to models
+template<typename T>
+const Model& get_model_ref(const T& item) noexcept {
+    if constexpr (is_model_v<T>) {
+        return item;
+    } else {
+        assert(item);
+        return *item;
+    }
+}
+
+// Writes models as JSON array through a single writer and stream buffer. Returns false if sink failed
+template<typename Range>
+bool write_array(const Range& models, Sink& sink) noexcept {
+    OutputStream stream(sink);
+    json_writer_t writer(stream);
+    writer.StartArray();
+    for (const auto& item : models) {
+        get_model_ref(item).to_json_internal(writer);
+    }
+    writer.EndArray();
+    return !stream.is_failed();
+}
+
+// Writes models as newline-delimited JSON, each model followed by '\n'. Returns false if sink failed
+template<typename Range>
+bool write_ndjson(const Range& models, Sink& sink) noexcept {
+    OutputStream stream(sink);
+    json_writer_t writer(stream);
+    stream.defer_flush(true);
+    for (const auto& item : models) {
+        writer.Reset(stream);
+        get_model_ref(item).to_json_internal(writer);
+        stream.Put('\n');
+    }
+    stream.defer_flush(false);
+    stream.Flush();
+    return !stream.is_failed();
+}
+
+inline size_t skip_json_whitespace(const std::string& json_str, size_t position) noexcept {
+    while (position < json_str.size() && (json_str[position] == ' ' || json_str[position] == '\n' ||
+                                           json_str[position] == '\r' || json_str[position] == '\t')) {
+        ++position;
+    }
+    return position;
+}
+
+// Finds spans of elements of the top-level array by tracking strings and open brackets, without parsing values.
+// Returns false if structure of the array is invalid. Elements themselves are validated when they are parsed
+inline bool find_array_elements(const std::string& json_str, std::vector<std::pair<size_t, size_t>>& elements) {
+    size_t position = skip_json_whitespace(json_str, 0);
+    if (position == json_str.size() || json_str[position] != '[') {
+        return false;
+    }
+    position = skip_json_whitespace(json_str, position + 1);
+    if (position < json_str.size() && json_str[position] == ']') {
+        ++position;
+    } else {
+        // Closing brackets expected by open arrays and objects inside the element
+        std::vector<char> closing;
+        while (true) {
+            size_t begin = position;
+            bool in_string = false;
+            for (; position < json_str.size(); ++position) {
+                char c = json_str[position];
+                if (in_string) {
+                    if (c == '\\') {
+                        ++position;
+                    } else if (c == '"') {
+                        in_string = false;
+                    }
+                } else if (c == '"') {
+                    in_string = true;
+                } else if (c == '{' || c == '[') {
+                    closing.push_back(c == '{' ? '}' : ']');
+                } else if (c == '}' || c == ']') {
+                    if (closing.empty()) break;
+                    if (closing.back() != c) return false;
+                    closing.pop_back();
+                } else if (c == ',' && closing.empty()) {
+                    break;
+                }
+            }
+            if (position >= json_str.size() || json_str[position] == '}') {
+                return false;
+            }
+            elements.emplace_back(begin, position - begin);
+            if (json_str[position++] == ']') break;
+        }
+    }
+    return skip_json_whitespace(json_str, position) == json_str.size();
+}
+
+// Parses JSON array into vector of models (or of any other field type) on the thread pool. Elements are found by a
+// sequential pre-scan of the source, then parsed in chunks. Each chunk reuses its document and allocator for elements,
+// unless dynamic values of the previous element keep the allocator. Errors are reported as by from_json() of the whole
+// array: if the pre-scan or any element finds a syntax error, the whole source is parsed sequentially to find the
+// first one, otherwise the error of the first failed element is thrown with its index in the trace. Existing elements
+// are parsed in place if the size matches, otherwise models are constructed anew, as they can't be moved
+template<typename T>
+bool parse_array(const std::string& json_str, std::vector<T>& values, ThreadPool& thread_pool,
+                 bool throw_on_error = true) {
+    // Syntax error is searched for in the whole source, so that it has the same offset and reason as with from_json()
+    auto report_syntax_error = [&json_str, throw_on_error]() {
+        if (!throw_on_error) {
+            return false;
+        }
+        using array_t = std::vector<std::conditional_t<is_model_v<T>, std::unique_ptr<T>, T>>;
+        rapidjson::Document document;
+        rapidjson::ParseResult result = parse_source(json_str, get_source_schema<array_t>(), document);
+        if (result.IsError()) {
+            throw ParseError(json_str, result.Offset(), rapidjson::GetParseError_En(result.Code()));
+        }
+        // Pre-scan and elements only fail on invalid JSON, unless root is valid but isn't an array
+        assert(!document.IsArray());
+        throw ParseError(json_str, skip_json_whitespace(json_str, 0), "Root is not an array.");
+    };
+
+    std::vector<std::pair<size_t, size_t>> elements;
+    if (!find_array_elements(json_str, elements)) {
+        return report_syntax_error();
+    }
+
+    if (values.size() != elements.size()) {
+        if constexpr (is_model_v<T>) {
+            std::vector<T>(elements.size()).swap(values);
+        } else {
+            size_t old_size = values.size();
+            values.resize(elements.size());
+            for (size_t i = old_size; i < values.size(); ++i) {
+                initialize(values[i]);
+            }
+        }
+    }
+
+    const size_t round_size = thread_pool.get_concurrency() * 4;
+    const size_t chunk_size = std::clamp<size_t>((elements.size() + round_size - 1) / round_size, 1,
+                                                 PARALLEL_CHUNK_SIZE);
+    const size_t chunk_count = (elements.size() + chunk_size - 1) / chunk_size;
+    // Syntax error of any element takes precedence, as whole document is parsed before models by from_json(). After
+    // the first schema error chunk is only checked for syntax errors
+    // Flags are not packed into bits, as chunks write them concurrently. Errors are thrown after parsing, as task
+    // can't throw
+    std::vector<char> syntax_failed(chunk_count, false);
+    std::vector<char> schema_failed(chunk_count, false);
+    std::vector<size_t> failed_indices(chunk_count);
+    std::vector<std::exception_ptr> schema_errors(chunk_count);
+
+    auto task = [&](size_t chunk) noexcept {
+        std::shared_ptr<json_allocator_t> allocator;
+        std::optional<rapidjson::Document> document;
+        size_t end = std::min(elements.size(), (chunk + 1) * chunk_size);
+        for (size_t i = chunk * chunk_size; i < end; ++i) {
+            if (allocator.use_count() == 1) {
+                // No value of the previous element keeps the allocator
+                document->SetNull();
+                allocator->Clear();
+            } else {
+                allocator = std::make_shared<json_allocator_t>();
+                document.emplace(allocator.get());
+            }
+            const char* json = json_str.data() + elements[i].first;
+            rapidjson::ParseResult result = parse_source(std::string_view(json, elements[i].second),
+                                                         get_source_schema<T>(), *document);
+            if (result.IsError()) {
+                syntax_failed[chunk] = true;
+                return;
+            }
+            if (schema_failed[chunk]) {
+                continue;
+            }
+            ParseContext context(std::string_view(json, elements[i].second), allocator);
+            try {
+                bool parsed;
+                if constexpr (is_model_v<T>) {
+                    parsed = values[i].from_json_internal(*document, throw_on_error);
+                } else {
+                    parsed = from_json(*document, values[i], throw_on_error);
+                }
+                schema_failed[chunk] = !parsed;
+            } catch (...) {
+                schema_failed[chunk] = true;
+                schema_errors[chunk] = std::current_exception();
+            }
+            if (schema_failed[chunk]) {
+                failed_indices[chunk] = i;
+            }
+        }
+    };
+    thread_pool.run(chunk_count, task);
+
+    if (std::find(syntax_failed.begin(), syntax_failed.end(), true) != syntax_failed.end()) {
+        return report_syntax_error();
+    }
+    for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+        if (schema_failed[chunk]) {
+            if (schema_errors[chunk]) {
+                try {
+                    std::rethrow_exception(schema_errors[chunk]);
+                } catch (SchemaError& error) {
+                    error.add_trace_index(failed_indices[chunk]);
+                    throw;
+                }
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_BATCH_H
@@ -0,0 +1,646 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_BINARY_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_BINARY_H
+
+#include "stream.h"
+
+#include "external/rapidjson/rapidjson.h"
+
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace json_model {
+
+// Writers and readers of MessagePack and CBOR. Binary formats are produced from the same field lists as JSON. Both
+// formats store number of elements before elements of array or map, so present members of each model are counted
+// before they are written. Readers produce SAX events for rapidjson::Document::Populate(), so decoded document is
+// assigned to model by from_json_internal() exactly as parsed JSON
+
+class BinaryWriter {
+public:
+    explicit BinaryWriter(OutputStream& stream) noexcept: stream_(stream) {}
+
+    void Flush() noexcept {
+        stream_.Flush();
+    }
+
+protected:
+    void write_byte(uint8_t byte) noexcept {
+        stream_.Put(static_cast<char>(byte));
+    }
+
+    // Writes type byte followed by `size` bytes of value in big-endian order
+    void write_big_endian(uint8_t type, uint64_t value, size_t size) noexcept {
+        char* out = stream_.get_buffer(size + 1);
+        *out++ = static_cast<char>(type);
+        for (size_t i = size; i > 0; --i) {
+            *out++ = static_cast<char>(static_cast<uint8_t>(value >> ((i - 1) * 8)));
+        }
+        stream_.advance(out);
+    }
+
+    void write_double_bits(uint8_t type, double value) noexcept {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        write_big_endian(type, bits, 8);
+    }
+
+    void write_bytes(const char* data, size_t size) noexcept {
+        stream_.write(data, size);
+    }
+
+private:
+    OutputStream& stream_;
+};
+
+class MsgPackWriter : public BinaryWriter {
+public:
+    explicit MsgPackWriter(OutputStream& stream) noexcept: BinaryWriter(stream) {}
+
+    void write_null() noexcept {
+        write_byte(0xc0);
+    }
+
+    void write_bool(bool value) noexcept {
+        write_byte(value ? 0xc3 : 0xc2);
+    }
+
+    void write_int(int64_t value) noexcept {
+        if (value >= 0) {
+            write_uint(static_cast<uint64_t>(value));
+        } else if (value >= -32) {
+            write_byte(static_cast<uint8_t>(value));
+        } else if (value >= std::numeric_limits<int8_t>::min()) {
+            write_big_endian(0xd0, static_cast<uint64_t>(value), 1);
+        } else if (value >= std::numeric_limits<int16_t>::min()) {
+            write_big_endian(0xd1, static_cast<uint64_t>(value), 2);
+        } else if (value >= std::numeric_limits<int32_t>::min()) {
+            write_big_endian(0xd2, static_cast<uint64_t>(value), 4);
+        } else {
+            write_big_endian(0xd3, static_cast<uint64_t>(value), 8);
+        }
+    }
+
+    void write_uint(uint64_t value) noexcept {
+        if (value < 0x80) {
+            write_byte(static_cast<uint8_t>(value));
+        } else if (value <= std::numeric_limits<uint8_t>::max()) {
+            write_big_endian(0xcc, value, 1);
+        } else if (value <= std::numeric_limits<uint16_t>::max()) {
+            write_big_endian(0xcd, value, 2);
+        } else if (value <= std::numeric_limits<uint32_t>::max()) {
+            write_big_endian(0xce, value, 4);
+        } else {
+            write_big_endian(0xcf, value, 8);
+        }
+    }
+
+    void write_double(double value) noexcept {
+        write_double_bits(0xcb, value);
+    }
+
+    void write_string(const char* str, size_t length) noexcept {
+        assert(length <= std::numeric_limits<uint32_t>::max());
+        if (length < 32) {
+            write_byte(static_cast<uint8_t>(0xa0 | length));
+        } else if (length <= std::numeric_limits<uint8_t>::max()) {
+            write_big_endian(0xd9, length, 1);
+        } else if (length <= std::numeric_limits<uint16_t>::max()) {
+            write_big_endian(0xda, length, 2);
+        } else {
+            write_big_endian(0xdb, length, 4);
+        }
+        write_bytes(str, length);
+    }
+
+    void start_array(size_t size) noexcept {
+        write_container_header(0x90, 0xdc, size);
+    }
+
+    void start_map(size_t size) noexcept {
+        write_container_header(0x80, 0xde, size);
+    }
+
+private:
+    // Fixed type is followed by 16-bit and 32-bit types
+    void write_container_header(uint8_t fixed_type, uint8_t type16, size_t size) noexcept {
+        assert(size <= std::numeric_limits<uint32_t>::max());
+        if (size < 16) {
+            write_byte(static_cast<uint8_t>(fixed_type | size));
+        } else if (size <= std::numeric_limits<uint16_t>::max()) {
+            write_big_endian(type16, size, 2);
+        } else {
+            write_big_endian(static_cast<uint8_t>(type16 + 1), size, 4);
+        }
+    }
+};
+
+class CborWriter : public BinaryWriter {
+public:
+    explicit CborWriter(OutputStream& stream) noexcept: BinaryWriter(stream) {}
+
+    void write_null() noexcept {
+        write_byte(0xf6);
+    }
+
+    void write_bool(bool value) noexcept {
+        write_byte(value ? 0xf5 : 0xf4);
+    }
+
+    void write_int(int64_t value) noexcept {
+        if (value >= 0) {
+            write_header(UNSIGNED, static_cast<uint64_t>(value));
+        } else {
+            // Negative integers are stored as -1 - value
+            write_header(NEGATIVE, ~static_cast<uint64_t>(value));
+        }
+    }
+
+    void write_uint(uint64_t value) noexcept {
+        write_header(UNSIGNED, value);
+    }
+
+    void write_double(double value) noexcept {
+        write_double_bits(0xfb, value);
+    }
+
+    void write_string(const char* str, size_t length) noexcept {
+        write_header(TEXT, length);
+        write_bytes(str, length);
+    }
+
+    void start_array(size_t size) noexcept {
+        write_header(ARRAY, size);
+    }
+
+    void start_map(size_t size) noexcept {
+        write_header(MAP, size);
+    }
+
+    // Major types
+    static constexpr uint8_t UNSIGNED = 0;
+    static constexpr uint8_t NEGATIVE = 1;
+    static constexpr uint8_t BYTES = 2;
+    static constexpr uint8_t TEXT = 3;
+    static constexpr uint8_t ARRAY = 4;
+    static constexpr uint8_t MAP = 5;
+    static constexpr uint8_t TAG = 6;
+    static constexpr uint8_t SIMPLE = 7;
+
+private:
+    void write_header(uint8_t major_type, uint64_t value) noexcept {
+        auto type = static_cast<uint8_t>(major_type << 5);
+        if (value < 24) {
+            write_byte(static_cast<uint8_t>(type | value));
+        } else if (value <= std::numeric_limits<uint8_t>::max()) {
+            write_big_endian(type | 24, value, 1);
+        } else if (value <= std::numeric_limits<uint16_t>::max()) {
+            write_big_endian(type | 25, value, 2);
+        } else if (value <= std::numeric_limits<uint32_t>::max()) {
+            write_big_endian(type | 26, value, 4);
+        } else {
+            write_big_endian(type | 27, value, 8);
+        }
+    }
+};
+
+// Counts members of a model which are written to binary formats, i.e. all fields except absent optionals
+class MemberCounter {
+public:
+    MemberCounter() noexcept: count_(0) {}
+
+    void add_member() noexcept {
+        count_++;
+    }
+
+    size_t get_count() const noexcept {
+        return count_;
+    }
+
+private:
+    size_t count_;
+};
+
+class BinaryReader {
+public:
+    BinaryReader(const char* data, size_t size) noexcept
+        : begin_(reinterpret_cast<const uint8_t*>(data)), cur_(begin_), end_(begin_ + size),
+          failed_(false), error_offset_(0), error_reason_(nullptr) {}
+
+    bool is_failed() const noexcept {
+        return failed_;
+    }
+
+    size_t get_error_offset() const noexcept {
+        return error_offset_;
+    }
+
+    const char* get_error_reason() const noexcept {
+        return error_reason_;
+    }
+
+protected:
+    bool fail(const char* reason) noexcept {
+        if (!failed_) {
+            failed_ = true;
+            error_offset_ = static_cast<size_t>(cur_ - begin_);
+            error_reason_ = reason;
+        }
+        return false;
+    }
+
+    bool at_end() const noexcept {
+        return cur_ == end_;
+    }
+
+    bool peek_byte(uint8_t& byte) noexcept {
+        if (cur_ == end_) {
+            return fail("Unexpected end of data");
+        }
+        byte = *cur_;
+        return true;
+    }
+
+    bool read_byte(uint8_t& byte) noexcept {
+        if (cur_ == end_) {
+            return fail("Unexpected end of data");
+        }
+        byte = *cur_++;
+        return true;
+    }
+
+    bool read_big_endian(size_t size, uint64_t& value) noexcept {
+        if (static_cast<size_t>(end_ - cur_) < size) {
+            return fail("Unexpected end of data");
+        }
+        value = 0;
+        for (size_t i = 0; i < size; ++i) {
+            value = (value << 8) | *cur_++;
+        }
+        return true;
+    }
+
+    bool read_bytes(size_t size, const char*& data) noexcept {
+        if (static_cast<size_t>(end_ - cur_) < size) {
+            return fail("Unexpected end of data");
+        }
+        data = reinterpret_cast<const char*>(cur_);
+        cur_ += size;
+        return true;
+    }
+
+    bool check_size(uint64_t size) noexcept {
+        if (size > std::numeric_limits<rapidjson::SizeType>::max()) {
+            return fail("Size is too large");
+        }
+        return true;
+    }
+
+    // Called after the root value is decoded
+    bool finish() noexcept {
+        if (!at_end()) {
+            return fail("Unexpected data after the root value");
+        }
+        return true;
+    }
+
+    static double to_double(uint64_t bits) noexcept {
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    static double to_double(uint32_t bits) noexcept {
+        float value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return static_cast<double>(value);
+    }
+
+private:
+    const uint8_t* begin_;
+    const uint8_t* cur_;
+    const uint8_t* end_;
+    bool failed_;
+    size_t error_offset_;
+    const char* error_reason_;
+};
+
+class MsgPackReader : public BinaryReader {
+public:
+    MsgPackReader(const char* data, size_t size) noexcept: BinaryReader(data, size) {}
+
+    static constexpr const char* FORMAT_NAME = "msgpack";
+
+    template<typename Handler>
+    bool operator()(Handler& handler) {
+        return read_value(handler) && finish();
+    }
+
+private:
+    template<typename Handler>
+    bool read_value(Handler& handler) {
+        uint8_t type;
+        if (!read_byte(type)) return false;
+
+        if (type < 0x80) {
+            return handler.Uint64(type);
+        } else if (type >= 0xe0) {
+            return handler.Int64(static_cast<int8_t>(type));
+        } else if (type < 0x90) {
+            return read_map(handler, type & 0x0f);
+        } else if (type < 0xa0) {
+            return read_array(handler, type & 0x0f);
+        } else if (type < 0xc0) {
+            return read_string(handler, type & 0x1f);
+        }
+
+        uint64_t value;
+        switch (type) {
+            case 0xc0:
+                return handler.Null();
+            case 0xc2:
+                return handler.Bool(false);
+            case 0xc3:
+                return handler.Bool(true);
+            case 0xca:
+                return read_big_endian(4, value) && handler.Double(to_double(static_cast<uint32_t>(value)));
+            case 0xcb:
+                return read_big_endian(8, value) && handler.Double(to_double(value));
+            case 0xcc:
+            case 0xcd:
+            case 0xce:
+            case 0xcf:
+                return read_big_endian(size_t(1) << (type - 0xcc), value) && handler.Uint64(value);
+            case 0xd0:
+                return read_big_endian(1, value) && handler.Int64(static_cast<int8_t>(value));
+            case 0xd1:
+                return read_big_endian(2, value) && handler.Int64(static_cast<int16_t>(value));
+            case 0xd2:
+                return read_big_endian(4, value) && handler.Int64(static_cast<int32_t>(value));
+            case 0xd3:
+                return read_big_endian(8, value) && handler.Int64(static_cast<int64_t>(value));
+            case 0xd9:
+            case 0xda:
+            case 0xdb:
+                return read_big_endian(size_t(1) << (type - 0xd9), value) && read_string(handler, value);
+            case 0xdc:
+                return read_big_endian(2, value) && read_array(handler, value);
+            case 0xdd:
+                return read_big_endian(4, value) && read_array(handler, value);
+            case 0xde:
+                return read_big_endian(2, value) && read_map(handler, value);
+            case 0xdf:
+                return read_big_endian(4, value) && read_map(handler, value);
+            default:
+                // Binary, extension types and reserved 0xc1
+                return fail("Unsupported type");
+        }
+    }
+
+    template<typename Handler>
+    bool read_string(Handler& handler, uint64_t length) {
+        const char* str;
+        return check_size(length) && read_bytes(length, str) &&
+               handler.String(str, static_cast<rapidjson::SizeType>(length), true);
+    }
+
+    template<typename Handler>
+    bool read_array(Handler& handler, uint64_t size) {
+        if (!handler.StartArray()) return false;
+        for (uint64_t i = 0; i < size; ++i) {
+            if (!read_value(handler)) return false;
+        }
+        return handler.EndArray(static_cast<rapidjson::SizeType>(size));
+    }
+
+    template<typename Handler>
+    bool read_map(Handler& handler, uint64_t size) {
+        if (!handler.StartObject()) return false;
+        for (uint64_t i = 0; i < size; ++i) {
+            uint8_t type;
+            if (!read_byte(type)) return false;
+            uint64_t length;
+            if (type >= 0xa0 && type < 0xc0) {
+                length = type & 0x1f;
+            } else if (type >= 0xd9 && type <= 0xdb) {
+                if (!read_big_endian(size_t(1) << (type - 0xd9), length)) return false;
+            } else {
+                return fail("Map key is not a string");
+            }
+            const char* key;
+            if (!check_size(length) || !read_bytes(length, key) ||
+                !handler.Key(key, static_cast<rapidjson::SizeType>(length), true)) {
+                return false;
+            }
+            if (!read_value(handler)) return false;
+        }
+        return handler.EndObject(static_cast<rapidjson::SizeType>(size));
+    }
+};
+
+class CborReader : public BinaryReader {
+public:
+    CborReader(const char* data, size_t size) noexcept: BinaryReader(data, size) {}
+
+    static constexpr const char* FORMAT_NAME = "cbor";
+
+    template<typename Handler>
+    bool operator()(Handler& handler) {
+        return read_value(handler) && finish();
+    }
+
+private:
+    static constexpr uint8_t INDEFINITE = 31;
+    static constexpr uint8_t BREAK = 0xff;
+
+    // Reads additional information of header, which is argument itself or its size
+    bool read_argument(uint8_t info, uint64_t& value) noexcept {
+        if (info < 24) {
+            value = info;
+            return true;
+        } else if (info < 28) {
+            return read_big_endian(size_t(1) << (info - 24), value);
+        }
+        return fail("Invalid additional information");
+    }
+
+    static double half_to_double(uint64_t half) noexcept {
+        auto exponent = static_cast<int>((half >> 10) & 0x1f);
+        auto mantissa = static_cast<double>(half & 0x3ff);
+        double value;
+        if (exponent == 0) {
+            value = std::ldexp(mantissa, -24);
+        } else if (exponent != 31) {
+            value = std::ldexp(mantissa + 1024, exponent - 25);
+        } else {
+            value = (mantissa == 0 ? std::numeric_limits<double>::infinity() : std::numeric_limits<double>::quiet_NaN());
+        }
+        return (half & 0x8000) ? -value : value;
+    }
+
+    template<typename Handler>
+    bool read_value(Handler& handler) {
+        uint8_t type;
+        if (!read_byte(type)) return false;
+        auto major_type = static_cast<uint8_t>(type >> 5);
+        auto info = static_cast<uint8_t>(type & 0x1f);
+        uint64_t value;
+
+        if (major_type == CborWriter::SIMPLE) {
+            switch (info) {
+                case 20:
+                    return handler.Bool(false);
+                case 21:
+                    return handler.Bool(true);
+                case 22:
+                    return handler.Null();
+                case 25:
+                    return read_big_endian(2, value) && handler.Double(half_to_double(value));
+                case 26:
+                    return read_big_endian(4, value) && handler.Double(to_double(static_cast<uint32_t>(value)));
+                case 27:
+                    return read_big_endian(8, value) && handler.Double(to_double(value));
+                default:
+                    return fail("Unsupported simple value");
+            }
+        }
+
+        if (major_type == CborWriter::TEXT) {
+            return read_string(handler, info);
+        }
+        if (info == INDEFINITE) {
+            switch (major_type) {
+                case CborWriter::ARRAY:
+                    return read_array(handler, 0, true);
+                case CborWriter::MAP:
+                    return read_map(handler, 0, true);
+                default:
+                    return fail("Invalid additional information");
+            }
+        }
+
+        if (!read_argument(info, value)) return false;
+        switch (major_type) {
+            case CborWriter::UNSIGNED:
+                return handler.Uint64(value);
+            case CborWriter::NEGATIVE:
+                if (value <= static_cast<uint64_t>(std::numeric_limits<int64_t>::max())) {
+                    return handler.Int64(-1 - static_cast<int64_t>(value));
+                }
+                // Doesn't fit into int64, same as JSON parser does for such numbers
+                return handler.Double(-1.0 - static_cast<double>(value));
+            case CborWriter::ARRAY:
+                return read_array(handler, value, false);
+            case CborWriter::MAP:
+                return read_map(handler, value, false);
+            case CborWriter::TAG:
+                // Tags are semantic hints, tagged value itself is decoded
+                return read_value(handler);
+            default:
+                return fail("Unsupported type");
+        }
+    }
+
+    // Reads text string which header has additional information `info`. Chunks of indefinite length string are
+    // concatenated into `buffer`
+    bool read_text(uint8_t info, const char*& str, uint64_t& length, std::string& buffer) noexcept {
+        if (info != INDEFINITE) {
+            return read_argument(info, length) && check_size(length) && read_bytes(length, str);
+        }
+        buffer.clear();
+        while (true) {
+            uint8_t type;
+            if (!read_byte(type)) return false;
+            if (type == BREAK) break;
+            if ((type >> 5) != CborWriter::TEXT || (type & 0x1f) == INDEFINITE) {
+                return fail("Invalid chunk of indefinite length string");
+            }
+            const char* chunk;
+            uint64_t chunk_length;
+            if (!read_argument(type & 0x1f, chunk_length) || !read_bytes(chunk_length, chunk)) return false;
+            buffer.append(chunk, chunk_length);
+        }
+        str = buffer.data();
+        length = buffer.size();
+        return check_size(length);
+    }
+
+    template<typename Handler>
+    bool read_string(Handler& handler, uint8_t info) {
+        const char* str;
+        uint64_t length;
+        std::string buffer;
+        return read_text(info, str, length, buffer) &&
+               handler.String(str, static_cast<rapidjson::SizeType>(length), true);
+    }
+
+    // Returns true if the next item of indefinite length container is break, which is consumed then
+    bool read_break(bool& is_break) noexcept {
+        uint8_t next;
+        if (!peek_byte(next)) return false;
+        is_break = (next == BREAK);
+        if (is_break) {
+            read_byte(next);
+        }
+        return true;
+    }
+
+    template<typename Handler>
+    bool read_array(Handler& handler, uint64_t size, bool indefinite) {
+        if (!handler.StartArray()) return false;
+        uint64_t count = 0;
+        while (true) {
+            if (indefinite) {
+                bool is_break;
+                if (!read_break(is_break)) return false;
+                if (is_break) break;
+            } else if (count == size) {
+                break;
+            }
+            if (!read_value(handler)) return false;
+            count++;
+        }
+        return check_size(count) && handler.EndArray(static_cast<rapidjson::SizeType>(count));
+    }
+
+    template<typename Handler>
+    bool read_map(Handler& handler, uint64_t size, bool indefinite) {
+        if (!handler.StartObject()) return false;
+        uint64_t count = 0;
+        std::string buffer;
+        while (true) {
+            if (indefinite) {
+                bool is_break;
+                if (!read_break(is_break)) return false;
+                if (is_break) break;
+            } else if (count == size) {
+                break;
+            }
+            uint8_t type;
+            if (!read_byte(type)) return false;
+            if ((type >> 5) != CborWriter::TEXT) {
+                return fail("Map key is not a string");
+            }
+            const char* key;
+            uint64_t length;
+            if (!read_text(type & 0x1f, key, length, buffer) ||
+                !handler.Key(key, static_cast<rapidjson::SizeType>(length), true)) {
+                return false;
+            }
+            if (!read_value(handler)) return false;
+            count++;
+        }
+        return check_size(count) && handler.EndObject(static_cast<rapidjson::SizeType>(count));
+    }
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_BINARY_H
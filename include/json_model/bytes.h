@@ -0,0 +1,214 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_BYTES_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_BYTES_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if (defined(__x86_64__) || defined(_M_X64)) && defined(__GNUC__)
+#define JSON_MODEL_SSSE3
+#include <immintrin.h>
+#endif
+
+namespace json_model {
+
+// Binary blob, which is stored in JSON as a base64 string (RFC 4648, with padding). Fields of this type are decoded
+// while parsing and encoded directly into the output buffer, without intermediate strings
+class Bytes : public std::vector<uint8_t> {
+public:
+    using std::vector<uint8_t>::vector;
+};
+
+inline constexpr char BASE64_ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+constexpr size_t base64_encoded_size(size_t size) noexcept {
+    return (size + 2) / 3 * 4;
+}
+
+// Values of base64 characters, or 0xFF for characters outside of alphabet
+constexpr std::array<uint8_t, 256> make_base64_values() noexcept {
+    std::array<uint8_t, 256> result{};
+    for (auto& value : result) {
+        value = 0xFF;
+    }
+    for (uint8_t i = 0; i < 64; ++i) {
+        result[static_cast<unsigned char>(BASE64_ALPHABET[i])] = i;
+    }
+    return result;
+}
+
+inline constexpr std::array<uint8_t, 256> BASE64_VALUES = make_base64_values();
+
+// Encoders write base64_encoded_size(end - begin) characters to out and return pointer past the last one
+
+inline char* base64_encode_scalar(const uint8_t* begin, const uint8_t* end, char* out) noexcept {
+    while (end - begin >= 3) {
+        uint32_t triple = (static_cast<uint32_t>(begin[0]) << 16) | (static_cast<uint32_t>(begin[1]) << 8) | begin[2];
+        *out++ = BASE64_ALPHABET[triple >> 18];
+        *out++ = BASE64_ALPHABET[(triple >> 12) & 0x3F];
+        *out++ = BASE64_ALPHABET[(triple >> 6) & 0x3F];
+        *out++ = BASE64_ALPHABET[triple & 0x3F];
+        begin += 3;
+    }
+    if (begin != end) {
+        uint32_t triple = static_cast<uint32_t>(begin[0]) << 16;
+        if (end - begin == 2) {
+            triple |= static_cast<uint32_t>(begin[1]) << 8;
+        }
+        *out++ = BASE64_ALPHABET[triple >> 18];
+        *out++ = BASE64_ALPHABET[(triple >> 12) & 0x3F];
+        *out++ = (end - begin == 2 ? BASE64_ALPHABET[(triple >> 6) & 0x3F] : '=');
+        *out++ = '=';
+    }
+    return out;
+}
+
+// Decoders write decoded bytes to out and return pointer past the last one, or nullptr if input is not valid base64.
+// Length of input must be a multiple of four
+
+inline uint8_t* base64_decode_scalar(const char* begin, const char* end, uint8_t* out) noexcept {
+    while (begin != end) {
+        size_t padding = 0;
+        if (end - begin == 4) {
+            padding = (begin[3] == '=' ? (begin[2] == '=' ? 2 : 1) : 0);
+        }
+        uint32_t quad = 0;
+        for (size_t i = 0; i < 4 - padding; ++i) {
+            uint8_t value = BASE64_VALUES[static_cast<unsigned char>(begin[i])];
+            if (value == 0xFF) {
+                return nullptr;
+            }
+            quad |= static_cast<uint32_t>(value) << (18 - 6 * i);
+        }
+        *out++ = static_cast<uint8_t>(quad >> 16);
+        if (padding < 2) {
+            *out++ = static_cast<uint8_t>(quad >> 8);
+        }
+        if (padding < 1) {
+            *out++ = static_cast<uint8_t>(quad);
+        }
+        begin += 4;
+    }
+    return out;
+}
+
+#ifdef JSON_MODEL_SSSE3
+// Vectorized codecs by Wojciech Mula: 12 bytes are spread to 16 six-bit indices with shuffles and multiplications,
+// which are mapped to characters with a lookup of per-range offsets, and the other way round when decoding
+
+__attribute__((target("ssse3")))
+inline char* base64_encode_ssse3(const uint8_t* begin, const uint8_t* end, char* out) noexcept {
+    const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    const __m128i offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '+' - 62, '/' - 63, 'A', 0, 0
+    );
+    // 16 bytes are loaded, of which 12 are encoded
+    while (end - begin >= 16) {
+        __m128i chunk = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(begin)), shuffle);
+        __m128i indices = _mm_or_si128(
+            _mm_mulhi_epu16(_mm_and_si128(chunk, _mm_set1_epi32(0x0FC0FC00)), _mm_set1_epi32(0x04000040)),
+            _mm_mullo_epi16(_mm_and_si128(chunk, _mm_set1_epi32(0x003F03F0)), _mm_set1_epi32(0x01000010))
+        );
+        __m128i range = _mm_or_si128(
+            _mm_subs_epu8(indices, _mm_set1_epi8(51)),
+            _mm_and_si128(_mm_cmpgt_epi8(_mm_set1_epi8(26), indices), _mm_set1_epi8(13))
+        );
+        __m128i chars = _mm_add_epi8(_mm_shuffle_epi8(offsets, range), indices);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), chars);
+        begin += 12;
+        out += 16;
+    }
+    return base64_encode_scalar(begin, end, out);
+}
+
+__attribute__((target("ssse3")))
+inline uint8_t* base64_decode_ssse3(const char* begin, const char* end, uint8_t* out) noexcept {
+    const __m128i lut_lo = _mm_setr_epi8(
+        0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+    );
+    const __m128i lut_hi = _mm_setr_epi8(
+        0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+    );
+    const __m128i lut_roll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+    const __m128i nibble_mask = _mm_set1_epi8(0x0F);
+    // 16 bytes are stored, of which 12 are decoded. Last 8 characters, which may contain padding, are left to scalar
+    // decoder, so that stores stay within output
+    while (end - begin >= 24) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(chunk, 4), nibble_mask);
+        __m128i lo_nibbles = _mm_and_si128(chunk, nibble_mask);
+        __m128i invalid = _mm_and_si128(_mm_shuffle_epi8(lut_lo, lo_nibbles), _mm_shuffle_epi8(lut_hi, hi_nibbles));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(invalid, _mm_setzero_si128())) != 0xFFFF) {
+            return nullptr;
+        }
+        __m128i slash = _mm_cmpeq_epi8(chunk, _mm_set1_epi8('/'));
+        __m128i values = _mm_add_epi8(chunk, _mm_shuffle_epi8(lut_roll, _mm_add_epi8(slash, hi_nibbles)));
+        __m128i merged = _mm_madd_epi16(
+            _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140)), _mm_set1_epi32(0x00011000)
+        );
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_shuffle_epi8(merged, pack));
+        begin += 16;
+        out += 12;
+    }
+    return base64_decode_scalar(begin, end, out);
+}
+#endif
+
+using base64_encode_t = char* (*)(const uint8_t*, const uint8_t*, char*) noexcept;
+using base64_decode_t = uint8_t* (*)(const char*, const char*, uint8_t*) noexcept;
+
+inline bool has_ssse3() noexcept {
+#ifdef JSON_MODEL_SSSE3
+    return __builtin_cpu_supports("ssse3");
+#else
+    return false;
+#endif
+}
+
+inline char* base64_encode(const uint8_t* begin, const uint8_t* end, char* out) noexcept {
+#ifdef JSON_MODEL_SSSE3
+    static const base64_encode_t impl = (has_ssse3() ? base64_encode_ssse3 : base64_encode_scalar);
+    return impl(begin, end, out);
+#else
+    return base64_encode_scalar(begin, end, out);
+#endif
+}
+
+// Replaces contents of bytes, reusing its capacity. Returns false if input is not valid base64
+inline bool base64_decode(const char* data, size_t size, Bytes& bytes) noexcept {
+    if (size % 4 != 0) {
+        return false;
+    }
+    if (size == 0) {
+        // Data of empty vector may be null, which decoders return on error
+        bytes.clear();
+        return true;
+    }
+    size_t padding = 0;
+    if (data[size - 1] == '=') {
+        padding = (data[size - 2] == '=' ? 2 : 1);
+    }
+    bytes.resize(size / 4 * 3 - padding);
+#ifdef JSON_MODEL_SSSE3
+    static const base64_decode_t impl = (has_ssse3() ? base64_decode_ssse3 : base64_decode_scalar);
+    uint8_t* end = impl(data, data + size, bytes.data());
+#else
+    uint8_t* end = base64_decode_scalar(data, data + size, bytes.data());
+#endif
+    if (end == nullptr) {
+        bytes.clear();
+        return false;
+    }
+    return true;
+}
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_BYTES_H
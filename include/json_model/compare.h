@@ -0,0 +1,134 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_COMPARE_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_COMPARE_H
+
+#include "traits.h"
+
+#include <cassert>
+#include <type_traits>
+#include <variant>
+
+namespace json_model {
+
+// Passes which work on two models of the same type at once. The first model is visited, and each of its fields is
+// matched with the field at the same offset in the second model
+class FieldPairs {
+public:
+    template<typename M>
+    FieldPairs(const M& first, const M& second) noexcept
+        : first_(reinterpret_cast<const char*>(&first)), second_(reinterpret_cast<const char*>(&second)) {}
+
+    // Returns field of the second model which corresponds to field of the first one
+    template<typename F>
+    const F& counterpart(const F& field) const noexcept {
+        return *reinterpret_cast<const F*>(second_ + (reinterpret_cast<const char*>(&field) - first_));
+    }
+
+private:
+    const char* first_;
+    const char* second_;
+};
+
+template<typename T>
+typename std::enable_if_t<is_primitive_v<T>, bool>
+values_equal(const T& lhs, const T& rhs) noexcept {
+    return lhs == rhs;
+}
+
+template<typename T>
+typename std::enable_if_t<is_pointer_v<T>, bool>
+values_equal(const T& lhs, const T& rhs) noexcept {
+    assert(lhs && rhs);
+    return lhs->equals_internal(*rhs);
+}
+
+template<typename T>
+typename std::enable_if_t<is_map_v<T>, bool>
+values_equal(const T& lhs, const T& rhs) noexcept;
+
+template<typename T>
+typename std::enable_if_t<is_variant_v<T>, bool>
+values_equal(const T& lhs, const T& rhs) noexcept;
+
+template<typename T>
+typename std::enable_if_t<is_vector_v<T>, bool>
+values_equal(const T& lhs, const T& rhs) noexcept {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (!values_equal(lhs[i], rhs[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename T>
+typename std::enable_if_t<is_map_v<T>, bool>
+values_equal(const T& lhs, const T& rhs) noexcept {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (const auto& item : lhs) {
+        auto iter = rhs.find(item.first);
+        if (iter == rhs.end() || !values_equal(item.second, iter->second)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+template<typename T>
+typename std::enable_if_t<is_variant_v<T>, bool>
+values_equal(const T& lhs, const T& rhs) noexcept {
+    assert(!lhs.valueless_by_exception() && !rhs.valueless_by_exception());
+    if (lhs.index() != rhs.index()) {
+        return false;
+    }
+    return std::visit(
+        [](auto&& lhs_arg, auto&& rhs_arg) noexcept {
+            if constexpr (std::is_same_v<std::decay_t<decltype(lhs_arg)>, std::decay_t<decltype(rhs_arg)>>) {
+                return values_equal(lhs_arg, rhs_arg);
+            } else {
+                return false;
+            }
+        }, lhs, rhs
+    );
+}
+
+template<typename T>
+typename std::enable_if_t<is_optional_v<T>, bool>
+values_equal(const T& lhs, const T& rhs) noexcept {
+    if (lhs.has_value() != rhs.has_value()) {
+        return false;
+    }
+    return !lhs.has_value() || values_equal(lhs.value(), rhs.value());
+}
+
+class FieldComparator : public FieldPairs {
+public:
+    template<typename M>
+    FieldComparator(const M& first, const M& second) noexcept: FieldPairs(first, second), equal_(true) {}
+
+    template<typename T>
+    void compare(const T& lhs, const T& rhs) noexcept {
+        if (equal_ && !values_equal(lhs, rhs)) {
+            equal_ = false;
+        }
+    }
+
+    bool is_equal() const noexcept {
+        return equal_;
+    }
+
+private:
+    bool equal_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_COMPARE_H
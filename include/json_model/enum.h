@@ -0,0 +1,190 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_ENUM_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_ENUM_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace json_model {
+
+// Enums are stored in JSON as strings. Values of enum must be consecutive and start from zero, and their JSON names
+// are listed in the same order with JSON_MODEL_ENUM in the namespace of enum, e.g.
+//     enum class Side : uint8_t { BUY, SELL };
+//     JSON_MODEL_ENUM(Side, "buy", "sell");
+
+template<typename... Names>
+constexpr std::array<std::string_view, sizeof...(Names)> make_enum_names(Names... names) noexcept {
+    return {std::string_view(names)...};
+}
+
+constexpr uint64_t enum_name_hash(std::string_view name) noexcept {
+    uint64_t hash = 14695981039346656037ULL;
+    for (char c : name) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash ^ (hash >> 32);
+}
+
+// Hash of name mixed with displacement of its bucket
+constexpr uint64_t enum_slot_hash(uint64_t hash, uint32_t displacement) noexcept {
+    hash ^= displacement * 0x9e3779b97f4a7c15ULL;
+    hash *= 0xff51afd7ed558ccdULL;
+    return hash ^ (hash >> 33);
+}
+
+// Names are looked up with a perfect hash table built at compile time with hash and displace: names are split into
+// buckets by their hash, and each bucket gets a displacement, which moves all its names to free slots of the table.
+// Buckets are placed from the largest one, and table is twice as large as the number of names, so displacements
+// are found in a few attempts for enums of any size
+template<typename E>
+class EnumTable {
+public:
+    static constexpr auto NAMES = json_model_enum_names(E());
+    static constexpr size_t SIZE = NAMES.size();
+
+    // Returns empty string for values out of range
+    static std::string_view get_name(E value) noexcept {
+        auto index = static_cast<size_t>(value);
+        return index < SIZE ? NAMES[index] : std::string_view();
+    }
+
+    // Returns false if there is no such name
+    static bool find(std::string_view name, E& value) noexcept {
+        uint64_t hash = enum_name_hash(name);
+        uint32_t displacement = TABLE.displacements[hash & (BUCKETS - 1)];
+        uint32_t slot = TABLE.slots[enum_slot_hash(hash, displacement) & (SLOTS - 1)];
+        if (slot == 0 || NAMES[slot - 1] != name) {
+            return false;
+        }
+        value = static_cast<E>(slot - 1);
+        return true;
+    }
+
+    // Names separated by '|', for error messages
+    static std::string describe() noexcept {
+        std::string result;
+        for (std::string_view name : NAMES) {
+            if (!result.empty()) {
+                result += '|';
+            }
+            result += '"';
+            result += name;
+            result += '"';
+        }
+        return result;
+    }
+
+private:
+    static constexpr size_t power_of_two_at_least(size_t size) noexcept {
+        size_t result = 1;
+        while (result < size) {
+            result *= 2;
+        }
+        return result;
+    }
+
+    static constexpr size_t BUCKETS = power_of_two_at_least(SIZE);
+    static constexpr size_t SLOTS = power_of_two_at_least(SIZE * 2);
+    static constexpr uint32_t MAX_DISPLACEMENT = 1 << 16;
+
+    struct Table {
+        std::array<uint32_t, BUCKETS> displacements{};
+        // Index of name plus one, or zero for empty slot
+        std::array<uint32_t, SLOTS> slots{};
+        bool unique = true;
+        bool complete = true;
+    };
+
+    static constexpr Table build_table() noexcept {
+        Table table;
+        std::array<uint64_t, SIZE> hashes{};
+        std::array<size_t, BUCKETS + 1> bucket_begin{};
+        for (size_t i = 0; i < SIZE; ++i) {
+            hashes[i] = enum_name_hash(NAMES[i]);
+            ++bucket_begin[(hashes[i] & (BUCKETS - 1)) + 1];
+        }
+        size_t max_bucket_size = 0;
+        for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+            max_bucket_size = std::max(max_bucket_size, bucket_begin[bucket + 1]);
+            bucket_begin[bucket + 1] += bucket_begin[bucket];
+        }
+        // Indices of names grouped by bucket
+        std::array<size_t, SIZE> members{};
+        std::array<size_t, BUCKETS> filled{};
+        for (size_t i = 0; i < SIZE; ++i) {
+            size_t bucket = hashes[i] & (BUCKETS - 1);
+            members[bucket_begin[bucket] + filled[bucket]++] = i;
+        }
+
+        for (size_t bucket_size = max_bucket_size; bucket_size != 0; --bucket_size) {
+            for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+                size_t begin = bucket_begin[bucket];
+                if (bucket_begin[bucket + 1] - begin != bucket_size) {
+                    continue;
+                }
+                // Equal names have equal hashes, so they are always in the same bucket
+                for (size_t i = begin; i < begin + bucket_size; ++i) {
+                    for (size_t j = begin; j < i; ++j) {
+                        if (NAMES[members[i]] == NAMES[members[j]]) {
+                            table.unique = false;
+                            return table;
+                        }
+                    }
+                }
+                uint32_t displacement = 0;
+                while (!fits(table, hashes, members, begin, bucket_size, displacement)) {
+                    if (++displacement == MAX_DISPLACEMENT) {
+                        table.complete = false;
+                        return table;
+                    }
+                }
+                table.displacements[bucket] = displacement;
+                for (size_t i = begin; i < begin + bucket_size; ++i) {
+                    size_t slot = enum_slot_hash(hashes[members[i]], displacement) & (SLOTS - 1);
+                    table.slots[slot] = static_cast<uint32_t>(members[i] + 1);
+                }
+            }
+        }
+        return table;
+    }
+
+    // Checks that names of bucket go to different free slots
+    static constexpr bool fits(const Table& table, const std::array<uint64_t, SIZE>& hashes,
+                               const std::array<size_t, SIZE>& members, size_t begin, size_t bucket_size,
+                               uint32_t displacement) noexcept {
+        for (size_t i = begin; i < begin + bucket_size; ++i) {
+            size_t slot = enum_slot_hash(hashes[members[i]], displacement) & (SLOTS - 1);
+            if (table.slots[slot] != 0) {
+                return false;
+            }
+            for (size_t j = begin; j < i; ++j) {
+                if ((enum_slot_hash(hashes[members[j]], displacement) & (SLOTS - 1)) == slot) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static constexpr Table TABLE = build_table();
+    static_assert(TABLE.unique, "Enum names must be unique");
+    static_assert(TABLE.complete, "Perfect hash of enum names is not found");
+};
+
+} // namespace json_model
+
+#define JSON_MODEL_ENUM(enum_name, ...)\
+static_assert(true); /* to ensure correct indentation when using code formatter */ \
+[[maybe_unused]] constexpr auto json_model_enum_names(enum_name) noexcept {\
+    return json_model::make_enum_names(__VA_ARGS__);\
+}
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_ENUM_H
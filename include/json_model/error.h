@@ -7,6 +7,7 @@
 
 #include "external/rapidjson/document.h"
 
+#include <cassert>
 #include <string>
 #include <exception>
 #include <vector>
@@ -27,7 +28,13 @@ protected:
 class ParseError : public Exception {
 public:
     ParseError(const std::string& json_str, size_t offset, const std::string& reason) noexcept
+        : ParseError(json_str, 0, offset, reason) {}
+
+    // Only part of source is available, which starts at `source_offset`, e.g. when source is received in chunks
+    ParseError(const std::string& json_str, size_t source_offset, size_t offset, const std::string& reason) noexcept
         : Exception(), offset_(offset), reason_(reason) {
+        assert(offset >= source_offset && offset - source_offset <= json_str.size());
+        offset -= source_offset;
         size_t segment_start, segment_end;
         size_t available_at_left = offset;
         size_t available_at_right = json_str.size() - offset;
@@ -97,6 +104,41 @@ private:
     const inline static size_t SEGMENT_SIZE = 30;
 };
 
+// Error in MessagePack or CBOR data. Schema errors of decoded data are reported same as for JSON
+class DecodeError : public Exception {
+public:
+    DecodeError(const std::string& format, size_t offset, const std::string& reason) noexcept
+        : Exception(), format_(format), offset_(offset), reason_(reason) {}
+    ~DecodeError() noexcept override = default;
+
+    const char* what() const noexcept override {
+        return "Failed to decode binary data";
+    }
+
+    std::string get_compact() const noexcept override {
+        return "Cannot decode " + format_ + " (offset " + std::to_string(offset_) + "): " + reason_;
+    }
+
+    std::string get_prettified() const noexcept override {
+        return "Cannot decode " + format_ + ":\n"
+               "  reason: " + reason_ + "\n" +
+               "  offset: " + std::to_string(offset_);
+    }
+
+    size_t get_offset() const noexcept {
+        return offset_;
+    }
+
+    const std::string& get_reason() const noexcept {
+        return reason_;
+    }
+
+private:
+    std::string format_;
+    size_t offset_;
+    std::string reason_;
+};
+
 inline const char* get_type_string(rapidjson::Type type) noexcept {
     switch (type) {
         case rapidjson::Type::kNullType:
@@ -178,6 +220,31 @@ private:
     std::string actual_;
 };
 
+class SizeMismatchError : public SchemaError {
+public:
+    SizeMismatchError(size_t expected, size_t actual) noexcept: SchemaError(), expected_(expected), actual_(actual) {}
+    ~SizeMismatchError() noexcept override = default;
+
+    std::string get_compact() const noexcept override {
+        return "Size mismatch at '" + build_trace() + "' (expected: " + std::to_string(expected_) +
+               ", actual: " + std::to_string(actual_) + ")";
+    }
+    std::string get_prettified() const noexcept override {
+        return "Array size mismatch:\n"
+               "   expected: " + build_trace() + "\n" +
+               "  which has: " + std::to_string(actual_) + " elements\n" +
+               "    to have: " + std::to_string(expected_) + " elements";
+    }
+
+    const char* what() const noexcept override {
+        return "Size mismatch";
+    }
+
+private:
+    size_t expected_;
+    size_t actual_;
+};
+
 class MissingKeyError : public SchemaError {
 public:
     MissingKeyError(const std::string& key) : SchemaError(), key_(key) {}
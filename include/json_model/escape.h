@@ -0,0 +1,142 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_ESCAPE_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_ESCAPE_H
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define JSON_MODEL_SSE2
+#include <emmintrin.h>
+#if defined(__GNUC__)
+#define JSON_MODEL_AVX2
+#include <immintrin.h>
+#endif
+#endif
+
+namespace json_model {
+
+// Characters which must be escaped in JSON strings are control characters, quotation mark and reverse solidus.
+// Functions below return pointer to the first such character in [begin, end), or end if there are none
+
+inline bool needs_escape(char c) noexcept {
+    return static_cast<unsigned char>(c) < 0x20 || c == '"' || c == '\\';
+}
+
+inline const char* find_escape_scalar(const char* begin, const char* end) noexcept {
+    while (begin != end && !needs_escape(*begin)) {
+        ++begin;
+    }
+    return begin;
+}
+
+#ifdef JSON_MODEL_SSE2
+inline const char* find_escape_sse2(const char* begin, const char* end) noexcept {
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    while (end - begin >= 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        __m128i mask = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_cmpeq_epi8(_mm_max_epu8(chunk, control), control)
+        );
+        auto bits = static_cast<unsigned>(_mm_movemask_epi8(mask));
+        if (bits != 0) {
+            return begin + __builtin_ctz(bits);
+        }
+        begin += 16;
+    }
+    return find_escape_scalar(begin, end);
+}
+#endif
+
+#ifdef JSON_MODEL_AVX2
+__attribute__((target("avx2")))
+inline const char* find_escape_avx2(const char* begin, const char* end) noexcept {
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1F);
+    while (end - begin >= 32) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        __m256i mask = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+            _mm256_cmpeq_epi8(_mm256_max_epu8(chunk, control), control)
+        );
+        auto bits = static_cast<unsigned>(_mm256_movemask_epi8(mask));
+        if (bits != 0) {
+            return begin + __builtin_ctz(bits);
+        }
+        begin += 32;
+    }
+    return find_escape_sse2(begin, end);
+}
+#endif
+
+using find_escape_t = const char* (*)(const char*, const char*) noexcept;
+
+inline find_escape_t select_find_escape() noexcept {
+#if defined(JSON_MODEL_AVX2)
+    if (__builtin_cpu_supports("avx2")) {
+        return find_escape_avx2;
+    }
+#endif
+#if defined(JSON_MODEL_SSE2)
+    return find_escape_sse2;
+#else
+    return find_escape_scalar;
+#endif
+}
+
+inline const char* find_escape(const char* begin, const char* end) noexcept {
+    // Short strings are more common than long ones, and don't benefit from vectorization
+    if (end - begin < 16) {
+        return find_escape_scalar(begin, end);
+    }
+    static const find_escape_t impl = select_find_escape();
+    return impl(begin, end);
+}
+
+// Writes escape sequence for c, which must satisfy needs_escape(). Returns pointer past the last written character,
+// at most 6 characters are written
+inline char* write_escape(char c, char* out) noexcept {
+    static constexpr char hex_digits[] = "0123456789ABCDEF";
+    *out++ = '\\';
+    switch (c) {
+        case '"':
+            *out++ = '"';
+            break;
+        case '\\':
+            *out++ = '\\';
+            break;
+        case '\b':
+            *out++ = 'b';
+            break;
+        case '\f':
+            *out++ = 'f';
+            break;
+        case '\n':
+            *out++ = 'n';
+            break;
+        case '\r':
+            *out++ = 'r';
+            break;
+        case '\t':
+            *out++ = 't';
+            break;
+        default:
+            *out++ = 'u';
+            *out++ = '0';
+            *out++ = '0';
+            *out++ = hex_digits[static_cast<unsigned char>(c) >> 4];
+            *out++ = hex_digits[static_cast<unsigned char>(c) & 0xF];
+    }
+    return out;
+}
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_ESCAPE_H
@@ -1425,7 +1425,7 @@ private:
     class NumberStream<InputStream, true, false> : public NumberStream<InputStream, false, false> {
         typedef NumberStream<InputStream, false, false> Base;
     public:
-        NumberStream(GenericReader& reader, InputStream& is) : Base(reader, is), stackStream(reader.stack_) {}
+        NumberStream(GenericReader& reader, InputStream& s) : Base(reader, s), stackStream(reader.stack_) {}
 
         RAPIDJSON_FORCEINLINE Ch TakePush() {
             stackStream.Put(static_cast<char>(Base::is.Peek()));
@@ -1451,7 +1451,7 @@ private:
     class NumberStream<InputStream, true, true> : public NumberStream<InputStream, true, false> {
         typedef NumberStream<InputStream, true, false> Base;
     public:
-        NumberStream(GenericReader& reader, InputStream& is) : Base(reader, is) {}
+        NumberStream(GenericReader& reader, InputStream& s) : Base(reader, s) {}
 
         RAPIDJSON_FORCEINLINE Ch Take() { return Base::TakePush(); }
     };
@@ -1657,8 +1657,13 @@ private:
                     int maxExp = 308 - expFrac;
                     while (RAPIDJSON_LIKELY(s.Peek() >= '0' && s.Peek() <= '9')) {
                         exp = exp * 10 + static_cast<int>(s.Take() - '0');
-                        if (RAPIDJSON_UNLIKELY(exp > maxExp))
-                            RAPIDJSON_PARSE_ERROR(kParseErrorNumberTooBig, startOffset);
+                        if (RAPIDJSON_UNLIKELY(exp > maxExp)) {
+                            // Numbers parsed as strings are not converted, so they may be out of range of double
+                            if (!(parseFlags & kParseNumbersAsStringsFlag))
+                                RAPIDJSON_PARSE_ERROR(kParseErrorNumberTooBig, startOffset);
+                            while (RAPIDJSON_UNLIKELY(s.Peek() >= '0' && s.Peek() <= '9'))  // Consume the rest of exponent
+                                s.Take();
+                        }
                     }
                 }
             }
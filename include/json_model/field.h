@@ -5,127 +5,201 @@
 #ifndef JSON_MODEL_INCLUDE_JSON_MODEL_FIELD_H
 #define JSON_MODEL_INCLUDE_JSON_MODEL_FIELD_H
 
+#include "fwd.h"
 #include "traits.h"
 #include "types.h"
 #include "init.h"
+#include "size.h"
+#include "to_binary.h"
+#include "snapshot.h"
+#include "compare.h"
+#include "patch.h"
+#include "parse_context.h"
+
+#include <cstring>
 
 namespace json_model {
 
-inline struct ConstructorDummy {} constructor_dummy;
+static_assert(DEFAULT_MAX_DECIMAL_PLACES == json_writer_t::kDefaultMaxDecimalPlaces);
 
-class JsonValueWrapper {
-public:
-    JsonValueWrapper(const json_value_t& value, bool throw_on_error) noexcept
-        : value_(value), throw_on_error_(throw_on_error), failed_(false) {}
+template<typename T>
+Field<T>::Field(ConstructorDummy, const char*, FieldOptions) noexcept {
+    static_assert(!std::is_pointer_v<T>, "Use std::unique_ptr instead of raw pointers");
+    static_assert(is_valid_for_field_v<T>);
 
-    const json_value_t& get_value() const noexcept {
-        return value_;
-    }
+    initialize(value_);
+}
 
-    bool throw_on_error() const noexcept {
-        return throw_on_error_;
+template<typename T>
+void Field<T>::operator()(KeyCollector& collector, const char* name, FieldOptions) const noexcept {
+    collector.add(name);
+}
+
+template<typename T>
+void Field<T>::operator()(json_writer_t& writer, const char*, FieldOptions options) const noexcept {
+    const FieldKey& key = writer.next_key();
+    int max_decimal_places = writer.GetMaxDecimalPlaces();
+    writer.SetMaxDecimalPlaces(options.max_decimal_places);
+    if constexpr (is_optional_v<T>) {
+        if (value_.has_value()) {
+            writer.write_key(key);
+            to_json(writer, value_.value());
+        }
+    } else {
+        writer.write_key(key);
+        to_json(writer, value_);
     }
+    writer.SetMaxDecimalPlaces(max_decimal_places);
+}
 
-    bool is_failed() const noexcept {
-        return failed_;
+template<typename T>
+void Field<T>::operator()(SizeCounter& counter, const char*, FieldOptions) const noexcept {
+    const FieldKey& key = counter.next_key();
+    if constexpr (is_optional_v<T>) {
+        if (value_.has_value()) {
+            counter.add_member(key, json_size(value_.value()));
+        }
+    } else {
+        counter.add_member(key, json_size(value_));
     }
+}
 
-    void fail() const noexcept {
-        failed_ = true;
+template<typename T>
+void Field<T>::operator()(MemberCounter& counter, const char*, FieldOptions) const noexcept {
+    if constexpr (is_optional_v<T>) {
+        if (!value_.has_value()) return;
     }
-private:
-    const json_value_t& value_;
-    bool throw_on_error_;
-    mutable bool failed_;
-};
+    counter.add_member();
+}
 
 template<typename T>
-class Field {
-public:
-    Field() = delete;
-    Field(ConstructorDummy, const char*) noexcept {
-        static_assert(!std::is_pointer_v<T>, "Use std::unique_ptr instead of raw pointers");
-        static_assert(is_valid_for_field_v<T>);
+void Field<T>::operator()(MsgPackWriter& writer, const char* name, FieldOptions) const noexcept {
+    to_binary_member(writer, name);
+}
 
-        initialize(value_);
-    }
+template<typename T>
+void Field<T>::operator()(CborWriter& writer, const char* name, FieldOptions) const noexcept {
+    to_binary_member(writer, name);
+}
 
-    void operator()(json_writer_t& writer, const char* name) const noexcept {
-        if constexpr (is_optional_v<T>) {
-            if (value_.has_value()) {
-                writer.Key(name);
-                to_json(writer, value_.value());
-            }
+template<typename T>
+void Field<T>::operator()(SnapshotWriter& writer, const char*, FieldOptions) const noexcept {
+    if constexpr (is_optional_v<T>) {
+        if (value_.has_value()) {
+            writer.add_slot(to_snapshot(writer, value_.value()));
         } else {
-            writer.Key(name);
-            to_json(writer, value_);
+            writer.add_slot(0, false);
         }
+    } else {
+        writer.add_slot(to_snapshot(writer, value_));
     }
+}
 
-    void operator()(const JsonValueWrapper& value_wrapper, const char* name) {
-        if (value_wrapper.is_failed()) return;
-        if (!value_wrapper.get_value().HasMember(name)) {
-            if constexpr (is_optional_v<T>) {
-                value_.reset();
-            } else {
-                value_wrapper.fail();
-                if (value_wrapper.throw_on_error()) {
-                    throw MissingKeyError(name);
-                }
+template<typename T>
+void Field<T>::operator()(SchemaCollector& collector, const char* name, FieldOptions) const noexcept {
+    collector.add_field<T>(name);
+}
+
+template<typename T>
+void Field<T>::operator()(SourceSchemaCollector& collector, const char* name, FieldOptions) const noexcept {
+    collector.add_field<T>(name);
+}
+
+template<typename T>
+void Field<T>::operator()(FieldComparator& comparator, const char*, FieldOptions) const noexcept {
+    comparator.compare(value_, comparator.counterpart(*this).value_);
+}
+
+template<typename T>
+void Field<T>::operator()(FieldDiff& diff, const char* name, FieldOptions options) const noexcept {
+    diff.diff(name, value_, diff.counterpart(*this).value_, options.max_decimal_places);
+}
+
+template<typename T>
+void Field<T>::operator()(const PatchApplier& applier, const char* name, FieldOptions) {
+    applier.apply(name, value_);
+}
+
+template<typename T>
+void Field<T>::operator()(FieldResetter&, const char*, FieldOptions) noexcept {
+    reset_value(value_);
+}
+
+template<typename T>
+template<typename Visitor>
+void Field<T>::operator()(FieldVisitor<Visitor>& visitor, const char* name, FieldOptions) {
+    visitor.visit(name, value_);
+}
+
+template<typename T>
+template<typename Visitor>
+void Field<T>::operator()(FieldVisitor<Visitor>& visitor, const char* name, FieldOptions) const {
+    visitor.visit(name, value_);
+}
+
+template<typename T>
+void Field<T>::operator()(const JsonValueWrapper& value_wrapper, const char* name, FieldOptions) {
+    if (value_wrapper.is_failed()) return;
+    if (!value_wrapper.get_value().HasMember(name)) {
+        if constexpr (is_optional_v<T>) {
+            value_.reset();
+        } else {
+            value_wrapper.fail();
+            if (value_wrapper.throw_on_error()) {
+                throw MissingKeyError(name);
             }
-            return;
         }
-        const auto& json_value = value_wrapper.get_value()[name];
+        return;
+    }
+    const auto& json_value = value_wrapper.get_value()[name];
 
-        if (value_wrapper.throw_on_error()) {
-            try {
-                if constexpr (is_optional_v<T>) {
+    if (value_wrapper.throw_on_error()) {
+        try {
+            if constexpr (is_optional_v<T>) {
+                if (!value_.has_value()) {
                     value_.emplace();
                     initialize(value_.value());
-                    from_json(json_value, value_.value(), true);
-                } else {
-                    from_json(json_value, value_, true);
                 }
-            } catch (SchemaError& error) {
-                error.add_trace_key(name);
-                throw;
+                from_json(json_value, value_.value(), true);
+            } else {
+                from_json(json_value, value_, true);
             }
-        } else {
-            if constexpr (is_optional_v<T>) {
+        } catch (SchemaError& error) {
+            error.add_trace_key(name);
+            throw;
+        }
+    } else {
+        if constexpr (is_optional_v<T>) {
+            if (!value_.has_value()) {
                 value_.emplace();
                 initialize(value_.value());
-                if (!from_json(json_value, value_.value(), false)) {
-                    value_wrapper.fail();
-                    return;
-                }
-            } else {
-                if (!from_json(json_value, value_, false)) {
-                    value_wrapper.fail();
-                    return;
-                }
+            }
+            if (!from_json(json_value, value_.value(), false)) {
+                value_wrapper.fail();
+                return;
+            }
+        } else {
+            if (!from_json(json_value, value_, false)) {
+                value_wrapper.fail();
+                return;
             }
         }
     }
+}
 
-    T value_;
-};
-
-#define DECLARE_FIELD(name, type, ...)\
-static_assert(true); /* to ensure correct indentation when using code formatter */ \
-private:\
-    json_model::Field<type,##__VA_ARGS__> name;\
-public:\
-    type,##__VA_ARGS__& get_##name() noexcept {\
-        return name.value_;\
-    }\
-    type,##__VA_ARGS__ const& get_##name() const noexcept {\
-        return name.value_;\
-    }\
-    template <typename JsonModelT_, typename = typename std::enable_if_t<std::is_assignable_v<type,##__VA_ARGS__&, JsonModelT_>>>\
-    auto& set_##name(JsonModelT_&& new_##name) noexcept(noexcept(name.value_ = std::forward<JsonModelT_>(new_##name))) {\
-        name.value_ = std::forward<JsonModelT_>(new_##name);\
-        return *this;\
+template<typename T>
+template<typename Writer>
+void Field<T>::to_binary_member(Writer& writer, const char* name) const noexcept {
+    if constexpr (is_optional_v<T>) {
+        if (value_.has_value()) {
+            writer.write_string(name, std::strlen(name));
+            to_binary(writer, value_.value());
+        }
+    } else {
+        writer.write_string(name, std::strlen(name));
+        to_binary(writer, value_);
     }
+}
 
 } // namespace json_model
 
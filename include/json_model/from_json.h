@@ -9,16 +9,62 @@
 #include "traits.h"
 #include "error.h"
 #include "init.h"
+#include "parse_context.h"
 
 #include "external/rapidjson/document.h"
+#include "external/rapidjson/error/en.h"
+
+#include <algorithm>
+#include <string>
+#include <string_view>
 #include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace json_model {
 
+// Sets text of raw value to its text in source of document being parsed, or to its compact JSON if value doesn't come
+// from parsed text, e.g. from binary formats
+template<typename T>
+void assign_source_text(const json_value_t& json_value, T& value) noexcept {
+    std::string_view source = ParseContext::find_source(json_value);
+    if (!source.empty()) {
+        value.set_text(source);
+        return;
+    }
+    std::string text;
+    StringSink sink(text);
+    OutputStream stream(sink);
+    json_writer_t writer(stream);
+    json_value.Accept(writer);
+    writer.Flush();
+    value.set_text(text);
+}
+
+// Type of value, which may be kept as text of source
+inline rapidjson::Type get_json_type(const json_value_t& json_value) noexcept {
+    std::string_view source = ParseContext::find_source(json_value);
+    return source.empty() ? json_value.GetType() : get_source_type(source);
+}
+
 template<typename T>
 typename std::enable_if_t<is_primitive_v<T>, bool>
 from_json(const json_value_t& json_value, T& value, bool throw_on_error) {
-    if constexpr (std::is_same_v<T, bool>) {
+    if constexpr (is_enum_v<T>) {
+        if (!json_value.IsString()) {
+            if (throw_on_error) {
+                throw TypeMismatchError(EnumTable<T>::describe(), json_value.GetType());
+            }
+            return false;
+        }
+        std::string_view name(json_value.GetString(), json_value.GetStringLength());
+        if (!EnumTable<T>::find(name, value)) {
+            if (throw_on_error) {
+                throw TypeMismatchError(EnumTable<T>::describe(), "\"" + std::string(name) + "\"");
+            }
+            return false;
+        }
+    } else if constexpr (std::is_same_v<T, bool>) {
         if (!json_value.IsBool()) {
             if (throw_on_error) {
                 throw TypeMismatchError("bool", json_value.GetType());
@@ -73,7 +119,37 @@ from_json(const json_value_t& json_value, T& value, bool throw_on_error) {
             }
             return false;
         }
-        value = json_value.GetString();
+        // Reuses capacity of the string
+        value.assign(json_value.GetString(), json_value.GetStringLength());
+    } else if constexpr (std::is_same_v<T, Bytes>) {
+        if (!json_value.IsString()) {
+            if (throw_on_error) {
+                throw TypeMismatchError("base64", json_value.GetType());
+            }
+            return false;
+        }
+        if (!base64_decode(json_value.GetString(), json_value.GetStringLength(), value)) {
+            if (throw_on_error) {
+                throw TypeMismatchError("base64", "invalid base64 string");
+            }
+            return false;
+        }
+    } else if constexpr (std::is_same_v<T, RawNumber>) {
+        // Numbers are kept as text by parser, so they may be of any size and precision
+        rapidjson::Type type = get_json_type(json_value);
+        if (type != rapidjson::kNumberType) {
+            if (throw_on_error) {
+                throw TypeMismatchError("number", type);
+            }
+            return false;
+        }
+        assign_source_text(json_value, value);
+    } else if constexpr (std::is_same_v<T, RawJson>) {
+        assign_source_text(json_value, value);
+    } else if constexpr (std::is_same_v<T, Value>) {
+        if (!ParseContext::take_value(json_value, value)) {
+            value.copy_from(json_value);
+        }
     } else if constexpr (std::is_same_v<T, std::nullptr_t>) {
         if (!json_value.IsNull()) {
             if (throw_on_error) {
@@ -109,27 +185,54 @@ from_json(const json_value_t& json_value, T& value, bool throw_on_error) {
         }
         return false;
     }
-    value.clear();
+    // Existing elements are parsed in place, so that their storage is reused. Elements which are accessed through
+    // proxies, as in std::vector<bool>, are parsed into a temporary and assigned
+    constexpr bool in_place = std::is_same_v<typename T::reference, typename T::value_type&>;
+    auto parse_element = [&json_value, &value](size_t i, bool throw_on_element_error) {
+        if constexpr (in_place) {
+            return from_json(json_value[i], value[i], throw_on_element_error);
+        } else {
+            typename T::value_type element;
+            initialize(element);
+            bool parsed = from_json(json_value[i], element, throw_on_element_error);
+            value[i] = std::move(element);
+            return parsed;
+        }
+    };
+    if constexpr (is_array_v<T>) {
+        if (json_value.Size() != value.size()) {
+            if (throw_on_error) {
+                throw SizeMismatchError(value.size(), json_value.Size());
+            }
+            return false;
+        }
+    } else {
+        size_t old_size = value.size();
+        value.resize(json_value.Size());
+        if constexpr (in_place) {
+            for (size_t i = old_size; i < value.size(); ++i) {
+                initialize(value[i]);
+            }
+        }
+    }
     for (size_t i = 0; i < json_value.Size(); ++i) {
-        typename T::value_type obj;
-        initialize(obj);
         if (throw_on_error) {
             try {
-                assert(from_json(json_value[i], obj, true));
+                parse_element(i, true);
             } catch (SchemaError& error) {
                 error.add_trace_index(i);
                 throw;
             }
         } else {
-            if (!from_json(json_value[i], obj, false)) {
+            if (!parse_element(i, false)) {
                 return false;
             }
         }
-        value.emplace_back(std::move(obj));
     }
     return true;
 }
 
+// Items with keys which are present in JSON are parsed in place. Nodes of other items are reused for new keys
 template<typename T>
 typename std::enable_if_t<is_map_v<T>, bool>
 from_json(const json_value_t& json_value, T& value, bool throw_on_error) {
@@ -139,42 +242,142 @@ from_json(const json_value_t& json_value, T& value, bool throw_on_error) {
         }
         return false;
     }
-    value.clear();
+
+    std::vector<typename T::node_type> free_nodes;
+    if (!value.empty()) {
+        // Buffer is not used while values are parsed, so nested maps may use it too
+        thread_local std::vector<std::string_view> keys;
+        keys.clear();
+        for (auto iter = json_value.MemberBegin(); iter != json_value.MemberEnd(); ++iter) {
+            keys.emplace_back(iter->name.GetString(), iter->name.GetStringLength());
+        }
+        std::sort(keys.begin(), keys.end());
+        for (auto iter = value.begin(); iter != value.end();) {
+            auto current = iter++;
+            if (!std::binary_search(keys.begin(), keys.end(), std::string_view(current->first))) {
+                free_nodes.push_back(value.extract(current));
+            }
+        }
+    }
+
     for (auto iter = json_value.MemberBegin(); iter != json_value.MemberEnd(); ++iter) {
-        typename T::mapped_type obj;
-        initialize(obj);
+        std::string_view key(iter->name.GetString(), iter->name.GetStringLength());
+        // Maps don't support heterogeneous lookup, so key is copied to a buffer which keeps its capacity
+        thread_local std::string lookup_key;
+        lookup_key.assign(key.data(), key.size());
+        auto item = value.find(lookup_key);
+        if (item == value.end()) {
+            if (!free_nodes.empty()) {
+                auto node = std::move(free_nodes.back());
+                free_nodes.pop_back();
+                node.key().assign(key.data(), key.size());
+                item = value.insert(std::move(node)).position;
+            } else {
+                item = value.emplace(std::string(key), typename T::mapped_type()).first;
+                initialize(item->second);
+            }
+        }
         if (throw_on_error) {
             try {
-                assert(from_json(iter->value, obj, true));
+                from_json(iter->value, item->second, true);
             } catch (SchemaError& error) {
                 error.add_trace_key(iter->name.GetString());
                 throw;
             }
         } else {
-            if (!from_json(iter->value, obj, false)) {
+            if (!from_json(iter->value, item->second, false)) {
                 return false;
             }
         }
-        value[iter->name.GetString()] = std::move(obj);
     }
     return true;
 }
 
+// Necessary condition for from_json() to succeed, which is checked before active alternative of variant is destroyed
+template<typename T>
+bool json_type_matches(const json_value_t& json_value) noexcept {
+    if constexpr (is_enum_v<T>) {
+        return json_value.IsString();
+    } else if constexpr (std::is_same_v<T, bool>) {
+        return json_value.IsBool();
+    } else if constexpr (std::is_same_v<T, double>) {
+        return json_value.IsLosslessDouble();
+    } else if constexpr (std::is_same_v<T, int>) {
+        return json_value.IsInt();
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        return json_value.IsInt64();
+    } else if constexpr (std::is_same_v<T, unsigned>) {
+        return json_value.IsUint();
+    } else if constexpr (std::is_same_v<T, uint64_t>) {
+        return json_value.IsUint64();
+    } else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, Bytes>) {
+        return json_value.IsString();
+    } else if constexpr (std::is_same_v<T, RawNumber>) {
+        return get_json_type(json_value) == rapidjson::kNumberType;
+    } else if constexpr (std::is_same_v<T, RawJson> || std::is_same_v<T, Value>) {
+        return true;
+    } else if constexpr (std::is_same_v<T, std::nullptr_t>) {
+        return json_value.IsNull();
+    } else if constexpr (is_vector_v<T>) {
+        return json_value.IsArray();
+    } else {
+        return json_value.IsObject();
+    }
+}
+
+// Active alternative is parsed in place, other alternatives are emplaced only if JSON type matches. Returns false
+// without throwing if alternative isn't the last one
+template<typename T, size_t I>
+bool alternative_from_json(const json_value_t& json_value, T& value, bool throw_on_error) {
+    constexpr bool IsLast = (I + 1 == std::variant_size_v<T>);
+    using V = typename std::variant_alternative_t<I, T>;
+    if (value.index() != I) {
+        if constexpr (!IsLast) {
+            if (!json_type_matches<V>(json_value)) {
+                return false;
+            }
+        }
+        value.template emplace<I>();
+        initialize(std::get<I>(value));
+    }
+    if constexpr (IsLast) {
+        return from_json(json_value, std::get<I>(value), throw_on_error);
+    } else {
+        // Value is parsed again by the next alternative if this one fails, so it must stay in document
+        ParseContext::CopyScope copy_scope;
+        return from_json(json_value, std::get<I>(value), false);
+    }
+}
+
+// Variants with raw alternatives are kept as text by parser, which is parsed again by schema of each alternative
 template<typename T, size_t I>
 typename std::enable_if_t<is_variant_v<T>, bool>
 from_json(const json_value_t& json_value, T& value, bool throw_on_error) {
     constexpr bool IsLast = (I + 1 == std::variant_size_v<T>);
     static_assert(std::variant_size_v<T> != 0);
     using V = typename std::variant_alternative_t<I, T>;
-    value.template emplace<V>();
-    initialize(std::get<V>(value));
+    bool parsed;
+    std::string_view source = ParseContext::find_source(json_value);
+    if (!source.empty() && !get_source_schema<V>().is_text()) {
+        rapidjson::Document document;
+        rapidjson::ParseResult result = parse_source(source, get_source_schema<V>(), document);
+        if (result.IsError()) {
+            // Only numbers which don't fit double fail, as source is already parsed
+            if (IsLast && throw_on_error) {
+                throw ParseError(std::string(source), result.Offset(), rapidjson::GetParseError_En(result.Code()));
+            }
+            parsed = false;
+        } else {
+            ParseContext::CopyScope copy_scope;
+            parsed = alternative_from_json<T, I>(document, value, throw_on_error);
+        }
+    } else {
+        parsed = alternative_from_json<T, I>(json_value, value, throw_on_error);
+    }
     if constexpr (IsLast) {
-        return from_json(json_value, std::get<V>(value), throw_on_error);
+        return parsed;
     } else {
-        if (from_json(json_value, std::get<V>(value), false)) {
-            return true;
-        }
-        return from_json<T, I + 1>(json_value, value, throw_on_error);
+        return parsed || from_json<T, I + 1>(json_value, value, throw_on_error);
     }
 }
 
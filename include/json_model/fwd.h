@@ -0,0 +1,346 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_FWD_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_FWD_H
+
+// Declarations of models and fields, which are enough to declare models, pass them around and access their fields.
+// Serialization and parsing are defined in model.h. Models declared with JSON_MODEL_DECLARE in headers which include
+// only this file are defined with JSON_MODEL_DEFINE in a single translation unit which includes model.h
+
+#include "external/rapidjson/fwd.h"
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iosfwd>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace json_model {
+
+class Sink;
+class ThreadPool;
+class Writer;
+class FieldKey;
+class KeyCollector;
+class SizeCounter;
+class MemberCounter;
+class MsgPackWriter;
+class CborWriter;
+class SnapshotWriter;
+class SchemaCollector;
+struct SnapshotSchema;
+class SourceSchemaCollector;
+class SourceSchema;
+class FieldComparator;
+class FieldDiff;
+class DiffWriter;
+class PatchApplier;
+struct FieldResetter;
+
+using json_writer_t = Writer;
+using json_value_t = rapidjson::Value;
+using KeyTable = std::vector<FieldKey>;
+
+inline struct ConstructorDummy {} constructor_dummy;
+
+class JsonValueWrapper {
+public:
+    JsonValueWrapper(const json_value_t& value, bool throw_on_error) noexcept
+        : value_(value), throw_on_error_(throw_on_error), failed_(false) {}
+
+    const json_value_t& get_value() const noexcept {
+        return value_;
+    }
+
+    bool throw_on_error() const noexcept {
+        return throw_on_error_;
+    }
+
+    bool is_failed() const noexcept {
+        return failed_;
+    }
+
+    void fail() const noexcept {
+        failed_ = true;
+    }
+private:
+    const json_value_t& value_;
+    bool throw_on_error_;
+    mutable bool failed_;
+};
+
+// Same as json_writer_t::kDefaultMaxDecimalPlaces
+inline constexpr int DEFAULT_MAX_DECIMAL_PLACES = 324;
+
+// Optional third argument of field description in PROVIDE_DETAILS
+struct FieldOptions {
+    int max_decimal_places = DEFAULT_MAX_DECIMAL_PLACES;
+};
+
+// Doubles in field are rounded to at most `places` digits after decimal point
+constexpr FieldOptions max_decimal_places(int places) noexcept {
+    assert(places >= 1);
+    return FieldOptions{places};
+}
+
+// Pass which calls `visitor(name, value)` for each field, see for_each_field()
+template<typename Visitor>
+class FieldVisitor {
+public:
+    explicit FieldVisitor(Visitor& visitor) noexcept: visitor_(visitor) {}
+
+    template<typename T>
+    void visit(const char* name, T& value) {
+        visitor_(name, value);
+    }
+
+private:
+    Visitor& visitor_;
+};
+
+// Each pass over fields of model calls one of these operators for every field. Operators are defined in field.h
+template<typename T>
+class Field {
+public:
+    Field() = delete;
+    // Defined in field.h, so that traits of field types aren't needed to declare models
+    Field(ConstructorDummy, const char*, FieldOptions = FieldOptions()) noexcept;
+
+    void operator()(KeyCollector& collector, const char* name, FieldOptions = FieldOptions()) const noexcept;
+    void operator()(json_writer_t& writer, const char*, FieldOptions options = FieldOptions()) const noexcept;
+    void operator()(SizeCounter& counter, const char*, FieldOptions = FieldOptions()) const noexcept;
+    void operator()(MemberCounter& counter, const char*, FieldOptions = FieldOptions()) const noexcept;
+    void operator()(MsgPackWriter& writer, const char* name, FieldOptions = FieldOptions()) const noexcept;
+    void operator()(CborWriter& writer, const char* name, FieldOptions = FieldOptions()) const noexcept;
+    void operator()(SnapshotWriter& writer, const char*, FieldOptions = FieldOptions()) const noexcept;
+    void operator()(SchemaCollector& collector, const char* name, FieldOptions = FieldOptions()) const noexcept;
+    void operator()(SourceSchemaCollector& collector, const char* name, FieldOptions = FieldOptions()) const noexcept;
+    void operator()(FieldComparator& comparator, const char*, FieldOptions = FieldOptions()) const noexcept;
+    void operator()(FieldDiff& diff, const char* name, FieldOptions options = FieldOptions()) const noexcept;
+    void operator()(const PatchApplier& applier, const char* name, FieldOptions = FieldOptions());
+    void operator()(FieldResetter&, const char*, FieldOptions = FieldOptions()) noexcept;
+
+    template<typename Visitor>
+    void operator()(FieldVisitor<Visitor>& visitor, const char* name, FieldOptions = FieldOptions());
+
+    template<typename Visitor>
+    void operator()(FieldVisitor<Visitor>& visitor, const char* name, FieldOptions = FieldOptions()) const;
+
+    void operator()(const JsonValueWrapper& value_wrapper, const char* name, FieldOptions = FieldOptions());
+
+    template<typename Writer>
+    void to_binary_member(Writer& writer, const char* name) const noexcept;
+
+    T value_;
+};
+
+#define DECLARE_FIELD(name, type, ...)\
+static_assert(true); /* to ensure correct indentation when using code formatter */ \
+private:\
+    json_model::Field<type,##__VA_ARGS__> name;\
+public:\
+    type,##__VA_ARGS__& get_##name() noexcept {\
+        mark_dirty();\
+        return name.value_;\
+    }\
+    type,##__VA_ARGS__ const& get_##name() const noexcept {\
+        return name.value_;\
+    }\
+    template <typename JsonModelT_, typename = typename std::enable_if_t<std::is_assignable_v<type,##__VA_ARGS__&, JsonModelT_>>>\
+    auto& set_##name(JsonModelT_&& new_##name) noexcept(noexcept(name.value_ = std::forward<JsonModelT_>(new_##name))) {\
+        mark_dirty();\
+        name.value_ = std::forward<JsonModelT_>(new_##name);\
+        return *this;\
+    }
+
+// Methods of models are defined in model.h
+class Model {
+public:
+    virtual ~Model() noexcept = default;
+
+    [[nodiscard]] std::string to_json() const noexcept;
+    bool to_json(Sink& sink) const noexcept;
+
+    // Vectors and maps of at least `min_parallel_size` elements are serialized in parallel on the thread pool
+    bool to_json(Sink& sink, ThreadPool& thread_pool, size_t min_parallel_size = DEFAULT_MIN_PARALLEL_SIZE) const noexcept;
+    [[nodiscard]] std::string to_json(ThreadPool& thread_pool, size_t min_parallel_size = DEFAULT_MIN_PARALLEL_SIZE) const noexcept;
+
+    bool to_json(std::ostream& os) const noexcept;
+    bool to_json(std::FILE* file) const noexcept;
+
+    // Upper bound on length of to_json() result, exact if model doesn't contain doubles
+    [[nodiscard]] size_t json_size() const noexcept;
+
+    bool from_json(const std::string& json_str, bool throw_on_error = true);
+
+    [[nodiscard]] std::string to_msgpack() const noexcept;
+    bool to_msgpack(Sink& sink) const noexcept;
+    bool from_msgpack(const std::string& data, bool throw_on_error = true);
+
+    [[nodiscard]] std::string to_cbor() const noexcept;
+    bool to_cbor(Sink& sink) const noexcept;
+    bool from_cbor(const std::string& data, bool throw_on_error = true);
+
+    // Keyless binary snapshot, which is read in place with views from snapshot_view.h
+    [[nodiscard]] std::string to_snapshot() const noexcept;
+    bool to_snapshot(Sink& sink) const noexcept;
+
+    static constexpr size_t DEFAULT_MIN_PARALLEL_SIZE = 16384;
+
+    // Plain models don't track modifications, see CachedModel
+    void mark_dirty() noexcept {}
+
+    virtual void to_json_internal(json_writer_t& writer) const noexcept = 0;
+    virtual size_t json_size_internal() const noexcept = 0;
+    virtual void to_binary_internal(MsgPackWriter& writer) const noexcept = 0;
+    virtual void to_binary_internal(CborWriter& writer) const noexcept = 0;
+    virtual uint64_t to_snapshot_internal(SnapshotWriter& writer) const noexcept = 0;
+    virtual uint64_t snapshot_fingerprint_internal() const noexcept = 0;
+    virtual const SourceSchema& source_schema_internal() const noexcept = 0;
+    virtual bool from_json_internal(const json_value_t& value_wrapper, bool throw_on_error) = 0;
+    virtual bool equals_internal(const Model& other) const noexcept = 0;
+    virtual void diff_internal(const Model& target, DiffWriter& writer) const noexcept = 0;
+    virtual bool apply_patch_internal(const json_value_t& patch, bool throw_on_error) = 0;
+    virtual void reset_internal() noexcept = 0;
+
+private:
+    template<typename Writer>
+    bool write_binary(Sink& sink) const noexcept;
+
+    // Binary data is decoded into a document, so that it is assigned to model same way as JSON
+    template<typename Reader>
+    bool read_binary(const std::string& data, bool throw_on_error);
+};
+
+// Model which keeps its JSON between to_json() calls and writes it again, unless the model was marked dirty. Setters,
+// mutable getters and from_json() mark model dirty. Each cached model is linked to the nearest cached model which
+// wrote it into its own JSON, so marking a nested model dirty marks its cached ancestors dirty too, even if it was
+// modified through a kept pointer. Plain models between them don't track modifications of their own fields.
+// to_json() of a cached model updates the cache, so it must not be called on the same model (or on models which share
+// nested models) from several threads at once, even if model is const. Parallel to_json() with a thread pool is fine
+class CachedModel : public Model {
+public:
+    CachedModel() noexcept = default;
+
+    // Links and cache aren't copied, copy is serialized again
+    CachedModel(const CachedModel& other) noexcept: Model(other) {}
+
+    CachedModel& operator=(const CachedModel& other) noexcept {
+        Model::operator=(other);
+        mark_dirty();
+        return *this;
+    }
+
+    // Ancestor which includes this model in its cache becomes stale
+    ~CachedModel() noexcept override {
+        if (parent_ != nullptr) {
+            parent_->invalidate();
+        }
+        detach_children();
+    }
+
+    void mark_dirty() noexcept {
+        invalidate();
+    }
+
+    template<typename T>
+    const std::string& get_json_cache(const T& model) const noexcept;
+
+    // Cache is valid until model is marked dirty
+    bool is_cache_valid() const noexcept {
+        return cache_valid_;
+    }
+
+    // Called when model is written into JSON of `parent`, possibly on a thread of the pool
+    void attach_to(const CachedModel* parent) const noexcept {
+        if (parent == nullptr || parent_ == parent) {
+            return;
+        }
+        if (parent_ != nullptr) {
+            // Model was moved to another parent bypassing mutable getters, so the old one is stale
+            parent_->invalidate();
+        }
+        parent_ = parent;
+        next_sibling_ = parent->first_child_.load();
+        while (!parent->first_child_.compare_exchange_weak(next_sibling_, this)) {}
+    }
+
+private:
+    // Invalid model has no linked children and its ancestors are invalid too, so propagation stops at it
+    void invalidate() const noexcept {
+        if (!cache_valid_) {
+            return;
+        }
+        cache_valid_ = false;
+        detach_children();
+        if (parent_ != nullptr) {
+            parent_->invalidate();
+        }
+    }
+
+    void detach_children() const noexcept {
+        const CachedModel* child = first_child_.exchange(nullptr);
+        while (child != nullptr) {
+            const CachedModel* next = child->next_sibling_;
+            if (child->parent_ == this) {
+                child->parent_ = nullptr;
+            }
+            child->next_sibling_ = nullptr;
+            child = next;
+        }
+    }
+
+    mutable std::string json_cache_;
+    mutable bool cache_valid_ = false;
+    mutable const CachedModel* parent_ = nullptr;
+    // Intrusive list of cached models written into json_cache_, which is appended from threads of the pool
+    mutable std::atomic<const CachedModel*> first_child_ = nullptr;
+    mutable const CachedModel* next_sibling_ = nullptr;
+};
+
+} // namespace json_model
+
+// Declares model methods, which are generated by PROVIDE_DETAILS, without defining them. Fields are listed in
+// JSON_MODEL_DEFINE, which must be placed in the namespace of model in one translation unit. for_each_field() can be
+// used only in that translation unit
+#define JSON_MODEL_DECLARE(class_name)\
+static_assert(true); /* to ensure correct indentation when using code formatter */ \
+public:\
+    ~class_name() noexcept override = default;\
+    explicit class_name(json_model::ConstructorDummy _ = json_model::constructor_dummy) noexcept;\
+    template<typename JsonModelPass_>\
+    void visit_fields_internal(JsonModelPass_& _);\
+    template<typename JsonModelPass_>\
+    void visit_fields_internal(JsonModelPass_& _) const;\
+    const json_model::KeyTable& json_keys_internal() const noexcept;\
+    void to_json_fields_internal(json_model::json_writer_t& _) const noexcept;\
+    void to_json_internal(json_model::json_writer_t& _) const noexcept override;\
+    size_t json_size_fields_internal() const noexcept;\
+    size_t json_size_internal() const noexcept override;\
+    size_t member_count_internal() const noexcept;\
+    void to_binary_internal(json_model::MsgPackWriter& _) const noexcept override;\
+    void to_binary_internal(json_model::CborWriter& _) const noexcept override;\
+    uint64_t to_snapshot_internal(json_model::SnapshotWriter& _) const noexcept override;\
+    void snapshot_schema_fields_internal(json_model::SchemaCollector& _) const noexcept;\
+    void source_schema_fields_internal(json_model::SourceSchemaCollector& _) const noexcept;\
+    const json_model::SourceSchema& source_schema_internal() const noexcept override;\
+    static const json_model::SnapshotSchema& snapshot_schema_internal() noexcept;\
+    uint64_t snapshot_fingerprint_internal() const noexcept override;\
+    bool equals_internal(const json_model::Model& other) const noexcept override;\
+    void diff_internal(const json_model::Model& target, json_model::DiffWriter& diff_writer) const noexcept override;\
+    bool apply_patch_internal(const json_model::json_value_t& patch, bool throw_on_error) override;\
+    void reset_internal() noexcept override;\
+    template<typename JsonModelVisitor_>\
+    void for_each_field_internal(json_model::FieldVisitor<JsonModelVisitor_>& _);\
+    template<typename JsonModelVisitor_>\
+    void for_each_field_internal(json_model::FieldVisitor<JsonModelVisitor_>& _) const;\
+    bool from_json_internal(const json_model::json_value_t& json_value, bool throw_on_error) override;
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_FWD_H
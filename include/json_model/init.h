@@ -5,6 +5,13 @@
 #ifndef JSON_MODEL_INCLUDE_JSON_MODEL_INIT_H
 #define JSON_MODEL_INCLUDE_JSON_MODEL_INIT_H
 
+#include "traits.h"
+
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <variant>
+
 namespace json_model {
 
 template<typename T>
@@ -13,6 +20,10 @@ void initialize(T& value) {
         value = T();
     } else if constexpr (is_pointer_v<T>) {
         value = std::make_unique<typename T::element_type>();
+    } else if constexpr (is_array_v<T>) {
+        for (auto& item : value) {
+            initialize(item);
+        }
     } else if constexpr (is_variant_v<T>) {
         static_assert(std::variant_size_v<T> > 0);
         using variant_first_t = typename std::variant_alternative_t<0, T>;
@@ -20,6 +31,57 @@ void initialize(T& value) {
             value = variant_first_t();
         } else if constexpr (is_pointer_v<variant_first_t>) {
             value = std::make_unique<typename variant_first_t::element_type>();
+        } else if constexpr (is_array_v<variant_first_t>) {
+            value.template emplace<0>();
+            initialize(std::get<0>(value));
+        }
+    }
+}
+
+struct FieldResetter {};
+
+// Returns value to the state of an initialized one, keeping storage of strings and containers and nested models.
+// Vectors and maps of nested models keep their elements, which are reset in place, so that from_json() reuses them
+template<typename T>
+void reset_value(T& value) noexcept {
+    if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, Bytes>) {
+        value.clear();
+    } else if constexpr (is_primitive_v<T>) {
+        value = T();
+    } else if constexpr (is_pointer_v<T>) {
+        if (value) {
+            value->reset_internal();
+        } else {
+            initialize(value);
+        }
+    } else if constexpr (is_array_v<T>) {
+        for (auto& item : value) {
+            reset_value(item);
+        }
+    } else if constexpr (is_vector_v<T>) {
+        if constexpr (is_pointer_v<typename T::value_type>) {
+            for (auto& item : value) {
+                reset_value(item);
+            }
+        } else {
+            value.clear();
+        }
+    } else if constexpr (is_map_v<T>) {
+        if constexpr (is_pointer_v<typename T::mapped_type>) {
+            for (auto& item : value) {
+                reset_value(item.second);
+            }
+        } else {
+            value.clear();
+        }
+    } else if constexpr (is_optional_v<T>) {
+        value.reset();
+    } else if constexpr (is_variant_v<T>) {
+        if (value.index() == 0) {
+            reset_value(std::get<0>(value));
+        } else {
+            value.template emplace<0>();
+            initialize(std::get<0>(value));
         }
     }
 }
@@ -6,16 +6,31 @@
 #define JSON_MODEL_INCLUDE_JSON_MODEL_MODEL_H
 
 #include "to_json.h"
+#include "to_binary.h"
+#include "snapshot.h"
+#include "compare.h"
+#include "patch.h"
 #include "from_json.h"
+#include "parse_context.h"
+#include "size.h"
 #include "traits.h"
 #include "error.h"
 #include "types.h"
 #include "field.h"
+#include "fwd.h"
+#include "stream.h"
+#include "thread_pool.h"
+#include "value.h"
 
 #include "external/rapidjson/writer.h"
-#include "external/rapidjson/stringbuffer.h"
 #include "external/rapidjson/error/en.h"
 
+#include <cstdio>
+#include <memory>
+#include <ostream>
+#include <type_traits>
+#include <typeinfo>
+
 // TODO: comparison functions
 // TODO: clang-format
 // TODO: encapsulate internal functions
@@ -24,56 +39,366 @@
 
 namespace json_model {
 
-class Model {
-public:
-    virtual ~Model() noexcept = default;
+inline std::string Model::to_json() const noexcept {
+    std::string result;
+    result.reserve(json_size());
+    StringSink sink(result);
+    to_json(sink);
+    return result;
+}
+
+inline bool Model::to_json(Sink& sink) const noexcept {
+    OutputStream stream(sink);
+    json_writer_t writer(stream);
+    to_json_internal(writer);
+    writer.Flush();
+    return !stream.is_failed();
+}
+
+inline bool Model::to_json(Sink& sink, ThreadPool& thread_pool, size_t min_parallel_size) const noexcept {
+    OutputStream stream(sink);
+    json_writer_t writer(stream);
+    writer.set_thread_pool(&thread_pool, min_parallel_size);
+    to_json_internal(writer);
+    writer.Flush();
+    return !stream.is_failed();
+}
+
+inline std::string Model::to_json(ThreadPool& thread_pool, size_t min_parallel_size) const noexcept {
+    std::string result;
+    StringSink sink(result);
+    to_json(sink, thread_pool, min_parallel_size);
+    return result;
+}
+
+inline bool Model::to_json(std::ostream& os) const noexcept {
+    OStreamSink sink(os);
+    return to_json(sink);
+}
+
+inline bool Model::to_json(std::FILE* file) const noexcept {
+    FileSink sink(file);
+    return to_json(sink);
+}
+
+inline size_t Model::json_size() const noexcept {
+    return json_size_internal();
+}
+
+inline bool Model::from_json(const std::string& json_str, bool throw_on_error) {
+    // Allocator is shared with dynamic values, which are moved out of document
+    auto allocator = std::make_shared<json_allocator_t>();
+    rapidjson::Document document(allocator.get());
+    rapidjson::ParseResult result = parse_source(json_str, source_schema_internal(), document);
+    if (result.IsError()) {
+        if (throw_on_error) {
+            throw ParseError(json_str, result.Offset(), rapidjson::GetParseError_En(result.Code()));
+        }
+        return false;
+    }
+
+    ParseContext context(json_str, std::move(allocator));
+    return from_json_internal(document, throw_on_error);
+}
+
+inline std::string Model::to_msgpack() const noexcept {
+    std::string result;
+    StringSink sink(result);
+    to_msgpack(sink);
+    return result;
+}
+
+inline bool Model::to_msgpack(Sink& sink) const noexcept {
+    return write_binary<MsgPackWriter>(sink);
+}
 
-    [[nodiscard]] std::string to_json() const noexcept {
-        rapidjson::StringBuffer buffer;
-        rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
-        to_json_internal(writer);
+inline bool Model::from_msgpack(const std::string& data, bool throw_on_error) {
+    return read_binary<MsgPackReader>(data, throw_on_error);
+}
+
+inline std::string Model::to_cbor() const noexcept {
+    std::string result;
+    StringSink sink(result);
+    to_cbor(sink);
+    return result;
+}
+
+inline bool Model::to_cbor(Sink& sink) const noexcept {
+    return write_binary<CborWriter>(sink);
+}
+
+inline bool Model::from_cbor(const std::string& data, bool throw_on_error) {
+    return read_binary<CborReader>(data, throw_on_error);
+}
+
+inline std::string Model::to_snapshot() const noexcept {
+    std::string result;
+    StringSink sink(result);
+    to_snapshot(sink);
+    return result;
+}
+
+inline bool Model::to_snapshot(Sink& sink) const noexcept {
+    OutputStream stream(sink);
+    SnapshotWriter writer(stream);
+    writer.write_header(snapshot_fingerprint_internal());
+    writer.write_footer(to_snapshot_internal(writer));
+    stream.Flush();
+    return !stream.is_failed();
+}
+
+template<typename Writer>
+bool Model::write_binary(Sink& sink) const noexcept {
+    OutputStream stream(sink);
+    Writer writer(stream);
+    to_binary_internal(writer);
+    writer.Flush();
+    return !stream.is_failed();
+}
+
+template<typename Reader>
+bool Model::read_binary(const std::string& data, bool throw_on_error) {
+    auto allocator = std::make_shared<json_allocator_t>();
+    rapidjson::Document document(allocator.get());
+    Reader reader(data.data(), data.size());
+    document.Populate(reader);
+    if (reader.is_failed()) {
+        if (throw_on_error) {
+            throw DecodeError(Reader::FORMAT_NAME, reader.get_error_offset(), reader.get_error_reason());
+        }
+        return false;
+    }
+
+    ParseContext context(std::string_view(), std::move(allocator));
+    return from_json_internal(document, throw_on_error);
+}
+
+template<typename T>
+const std::string& CachedModel::get_json_cache(const T& model) const noexcept {
+    if (!cache_valid_) {
+        json_cache_.clear();
+        StringSink sink(json_cache_);
+        // Nested models may be rebuilt recursively, so buffer is not placed on stack
+        auto stream = std::make_unique<OutputStream>(sink);
+        json_writer_t writer(*stream);
+        writer.set_cache_owner(this);
+        model.to_json_fields_internal(writer);
         writer.Flush();
-        return buffer.GetString();
+        cache_valid_ = true;
+    }
+    return json_cache_;
+}
+
+template<typename T>
+void write_model(json_writer_t& writer, const T& model) noexcept {
+    if constexpr (std::is_base_of_v<CachedModel, T>) {
+        model.attach_to(writer.get_cache_owner());
+        const std::string& json = model.get_json_cache(model);
+        writer.write_raw(json.data(), json.size(), rapidjson::kObjectType);
+    } else {
+        model.to_json_fields_internal(writer);
     }
+}
 
-    bool from_json(const std::string& json_str, bool throw_on_error = true) {
-        rapidjson::Document document;
-        if (document.Parse(json_str.c_str()).HasParseError()) {
-            if (throw_on_error) {
-                throw ParseError(json_str, document.GetErrorOffset(), rapidjson::GetParseError_En(document.GetParseError()));
-            }
-            return false;
+// Clean cached models have exact size of their JSON, so their fields and nested models aren't walked again
+template<typename T>
+size_t model_json_size(const T& model) noexcept {
+    if constexpr (std::is_base_of_v<CachedModel, T>) {
+        if (model.is_cache_valid()) {
+            return model.get_json_cache(model).size();
         }
+    }
+    return model.json_size_fields_internal();
+}
+
+// Calls `visitor(name, value)` for each field of model in declaration order, where name is the JSON name of field and
+// value is a reference to it, const if model is const. Calls are expanded at compile time, so visitor may be a generic
+// lambda which is instantiated for each field type
+template<typename M, typename Visitor>
+void for_each_field(M& model, Visitor&& visitor) {
+    static_assert(is_model_v<std::remove_const_t<M>>);
+    FieldVisitor<std::remove_reference_t<Visitor>> field_visitor(visitor);
+    model.for_each_field_internal(field_visitor);
+}
+
+// Returns JSON Merge Patch (RFC 7386) which transforms `source` into `target`. Only changed fields are written, nested
+// models and maps are compared recursively, and other values (including vectors) are written whole
+template<typename M>
+[[nodiscard]] std::string diff(const M& source, const M& target) noexcept {
+    static_assert(is_model_v<M>);
+    std::string result;
+    StringSink sink(result);
+    OutputStream stream(sink);
+    json_writer_t writer(stream);
+    DiffWriter diff_writer(writer);
+    writer.StartObject();
+    source.diff_internal(target, diff_writer);
+    writer.EndObject();
+    writer.Flush();
+    return result;
+}
 
-        return from_json_internal(document, throw_on_error);
+// Applies JSON Merge Patch to model in place, fields which are not mentioned in patch are not touched. On error
+// json_model::Exception is thrown or false returned, in which case model may be patched partially
+template<typename M>
+bool apply_patch(M& model, const std::string& patch_json, bool throw_on_error = true) {
+    static_assert(is_model_v<M>);
+    auto allocator = std::make_shared<json_allocator_t>();
+    rapidjson::Document document(allocator.get());
+    rapidjson::ParseResult result = parse_source(patch_json, get_source_schema<M>(), document, true);
+    if (result.IsError()) {
+        if (throw_on_error) {
+            throw ParseError(patch_json, result.Offset(), rapidjson::GetParseError_En(result.Code()));
+        }
+        return false;
     }
 
-    virtual void to_json_internal(json_writer_t& writer) const noexcept = 0;
-    virtual bool from_json_internal(const json_value_t& value_wrapper, bool throw_on_error) = 0;
-};
+    ParseContext context(patch_json, std::move(allocator));
+    return model.apply_patch_internal(document, throw_on_error);
+}
 
 } // namespace json_model
 
-#define PROVIDE_DETAILS(class_name, ...)\
-static_assert(true); /* to ensure correct indentation when using code formatter */ \
-public:\
-    ~class_name() noexcept override = default;\
-    explicit class_name(json_model::ConstructorDummy _ = json_model::constructor_dummy) noexcept : __VA_ARGS__ {};\
-    void to_json_internal(json_model::json_writer_t& _) const noexcept override {\
+// Definitions of methods generated for model, in class body (QUALIFIER, OVERRIDE and STATIC are empty, override
+// and static) or out of it (QUALIFIER is `class_name::`, others are empty). Field descriptions are expanded once, in
+// visit_fields_internal(), and each method runs its pass over them
+#define JSON_MODEL_DETAILS_INTERNAL(class_name, QUALIFIER, OVERRIDE, STATIC)\
+    const json_model::KeyTable& QUALIFIER json_keys_internal() const noexcept {\
+        static const json_model::KeyTable keys = [this]() noexcept {\
+            json_model::KeyCollector _;\
+            visit_fields_internal(_);\
+            return _.release();\
+        }();\
+        return keys;\
+    }\
+    void QUALIFIER to_json_fields_internal(json_model::json_writer_t& _) const noexcept {\
         _.StartObject();\
-        __VA_ARGS__;\
+        _.set_keys(json_keys_internal());\
+        visit_fields_internal(_);\
         _.EndObject();\
-    };\
-    bool from_json_internal(const json_model::json_value_t& json_value, bool throw_on_error) override {\
+    }\
+    void QUALIFIER to_json_internal(json_model::json_writer_t& _) const noexcept OVERRIDE {\
+        json_model::write_model(_, *this);\
+    }\
+    size_t QUALIFIER json_size_fields_internal() const noexcept {\
+        json_model::SizeCounter _(json_keys_internal());\
+        visit_fields_internal(_);\
+        return _.get_size();\
+    }\
+    size_t QUALIFIER json_size_internal() const noexcept OVERRIDE {\
+        return json_model::model_json_size(*this);\
+    }\
+    size_t QUALIFIER member_count_internal() const noexcept {\
+        json_model::MemberCounter _;\
+        visit_fields_internal(_);\
+        return _.get_count();\
+    }\
+    void QUALIFIER to_binary_internal(json_model::MsgPackWriter& _) const noexcept OVERRIDE {\
+        _.start_map(member_count_internal());\
+        visit_fields_internal(_);\
+    }\
+    void QUALIFIER to_binary_internal(json_model::CborWriter& _) const noexcept OVERRIDE {\
+        _.start_map(member_count_internal());\
+        visit_fields_internal(_);\
+    }\
+    uint64_t QUALIFIER to_snapshot_internal(json_model::SnapshotWriter& _) const noexcept OVERRIDE {\
+        size_t begin = _.start_slots();\
+        visit_fields_internal(_);\
+        return _.end_record(begin);\
+    }\
+    void QUALIFIER snapshot_schema_fields_internal(json_model::SchemaCollector& _) const noexcept {\
+        visit_fields_internal(_);\
+    }\
+    void QUALIFIER source_schema_fields_internal(json_model::SourceSchemaCollector& _) const noexcept {\
+        visit_fields_internal(_);\
+    }\
+    const json_model::SourceSchema& QUALIFIER source_schema_internal() const noexcept OVERRIDE {\
+        return json_model::get_source_schema<class_name>();\
+    }\
+    STATIC const json_model::SnapshotSchema& QUALIFIER snapshot_schema_internal() noexcept {\
+        static const json_model::SnapshotSchema schema = json_model::build_snapshot_schema<class_name>();\
+        return schema;\
+    }\
+    uint64_t QUALIFIER snapshot_fingerprint_internal() const noexcept OVERRIDE {\
+        return snapshot_schema_internal().fingerprint;\
+    }\
+    bool QUALIFIER equals_internal(const json_model::Model& other) const noexcept OVERRIDE {\
+        assert(typeid(other) == typeid(*this));\
+        json_model::FieldComparator _(*this, static_cast<const class_name&>(other));\
+        visit_fields_internal(_);\
+        return _.is_equal();\
+    }\
+    void QUALIFIER diff_internal(const json_model::Model& target, json_model::DiffWriter& diff_writer) const noexcept OVERRIDE {\
+        assert(typeid(target) == typeid(*this));\
+        json_model::FieldDiff _(diff_writer, *this, static_cast<const class_name&>(target));\
+        visit_fields_internal(_);\
+    }\
+    bool QUALIFIER apply_patch_internal(const json_model::json_value_t& patch, bool throw_on_error) OVERRIDE {\
+        mark_dirty();\
+        if (!patch.IsObject()) {\
+            if (throw_on_error) {\
+                throw json_model::TypeMismatchError(rapidjson::kObjectType, patch.GetType());\
+            }\
+            return false;\
+        }\
+        const json_model::PatchApplier _(patch, throw_on_error);\
+        visit_fields_internal(_);\
+        return !_.is_failed();\
+    }\
+    void QUALIFIER reset_internal() noexcept OVERRIDE {\
+        mark_dirty();\
+        json_model::FieldResetter _;\
+        visit_fields_internal(_);\
+    }\
+    template<typename JsonModelVisitor_>\
+    void QUALIFIER for_each_field_internal(json_model::FieldVisitor<JsonModelVisitor_>& _) {\
+        mark_dirty();\
+        visit_fields_internal(_);\
+    }\
+    template<typename JsonModelVisitor_>\
+    void QUALIFIER for_each_field_internal(json_model::FieldVisitor<JsonModelVisitor_>& _) const {\
+        visit_fields_internal(_);\
+    }\
+    bool QUALIFIER from_json_internal(const json_model::json_value_t& json_value, bool throw_on_error) OVERRIDE {\
+        mark_dirty();\
         if (!json_value.IsObject()) {\
             if (throw_on_error) {\
                 throw json_model::TypeMismatchError(rapidjson::kObjectType, json_value.GetType());\
             }\
             return false;\
         }\
-        json_model::JsonValueWrapper _(json_value, throw_on_error);\
-        __VA_ARGS__;\
+        const json_model::JsonValueWrapper _(json_value, throw_on_error);\
+        visit_fields_internal(_);\
         return !_.is_failed();\
     }
 
+#define PROVIDE_DETAILS(class_name, ...)\
+static_assert(true); /* to ensure correct indentation when using code formatter */ \
+public:\
+    ~class_name() noexcept override = default;\
+    explicit class_name(json_model::ConstructorDummy _ = json_model::constructor_dummy) noexcept : __VA_ARGS__ {}\
+    template<typename JsonModelPass_>\
+    void visit_fields_internal(JsonModelPass_& _) {\
+        __VA_ARGS__;\
+    }\
+    template<typename JsonModelPass_>\
+    void visit_fields_internal(JsonModelPass_& _) const {\
+        __VA_ARGS__;\
+    }\
+    JSON_MODEL_DETAILS_INTERNAL(class_name, , override, static)
+
+// Defines model declared with JSON_MODEL_DECLARE, arguments are the same as of PROVIDE_DETAILS
+#define JSON_MODEL_DEFINE(class_name, ...)\
+static_assert(true); /* to ensure correct indentation when using code formatter */ \
+class_name::class_name(json_model::ConstructorDummy _) noexcept : __VA_ARGS__ {}\
+template<typename JsonModelPass_>\
+void class_name::visit_fields_internal(JsonModelPass_& _) {\
+    __VA_ARGS__;\
+}\
+template<typename JsonModelPass_>\
+void class_name::visit_fields_internal(JsonModelPass_& _) const {\
+    __VA_ARGS__;\
+}\
+JSON_MODEL_DETAILS_INTERNAL(class_name, class_name::, , )
+
 #endif // JSON_MODEL_INCLUDE_JSON_MODEL_MODEL_H
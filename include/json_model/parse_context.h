@@ -0,0 +1,549 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_PARSE_CONTEXT_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_PARSE_CONTEXT_H
+
+#include "fwd.h"
+#include "traits.h"
+#include "value.h"
+
+#include "external/rapidjson/document.h"
+#include "external/rapidjson/reader.h"
+
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <typeindex>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace json_model {
+
+// Stream over source of document. Unlike rapidjson::MemoryStream, reader doesn't copy it, so position of the last read
+// token is known in handlers
+class PositionStream {
+public:
+    using Ch = char;
+
+    PositionStream(const char* json, size_t size) noexcept: begin_(json), cur_(json), end_(json + size) {}
+
+    char Peek() const noexcept {
+        return cur_ != end_ ? *cur_ : '\0';
+    }
+
+    char Take() noexcept {
+        return cur_ != end_ ? *cur_++ : '\0';
+    }
+
+    size_t Tell() const noexcept {
+        return static_cast<size_t>(cur_ - begin_);
+    }
+
+    // Only used by in situ parsing
+    char* PutBegin() noexcept {
+        assert(false);
+        return nullptr;
+    }
+
+    void Put(char) noexcept {
+        assert(false);
+    }
+
+    void Flush() noexcept {
+        assert(false);
+    }
+
+    size_t PutEnd(char*) noexcept {
+        assert(false);
+        return 0;
+    }
+
+private:
+    const char* begin_;
+    const char* cur_;
+    const char* end_;
+};
+
+class SourceSchema;
+
+// Adds fields of a model to its node of schema
+class SourceSchemaCollector {
+public:
+    SourceSchemaCollector(SourceSchema& schema, size_t node) noexcept: schema_(schema), node_(node) {}
+
+    template<typename T>
+    void add_field(const char* name) noexcept;
+
+private:
+    SourceSchema& schema_;
+    size_t node_;
+};
+
+// Describes values of documents parsed into a type, which are taken by raw fields. Parser keeps text of these values
+// in source instead of building them, so they are never converted. Nodes of nested models are shared, so recursive
+// models are described by a finite graph
+class SourceSchema {
+public:
+    enum Kind {
+        // Value has no raw values inside and is built as usual
+        PLAIN,
+        // Value is kept as text. These are RawJson and variants with raw values, which parse text by schema of each
+        // alternative
+        TEXT,
+        // Numbers are kept as text, other values are built (RawNumber)
+        NUMBER_TEXT,
+        // Items of arrays and values of objects are described by the only child (containers)
+        ITEMS,
+        // Members with names of fields are described by children, other members are plain (models)
+        FIELDS,
+        // Alternatives of variant are children. Only used while schema is built, variant becomes TEXT or PLAIN
+        VARIANT,
+    };
+
+    struct Node {
+        Kind kind;
+        std::vector<size_t> children;
+        std::vector<std::string> names;
+    };
+
+    template<typename T>
+    static SourceSchema build() noexcept {
+        SourceSchema schema;
+        schema.root_ = schema.add<T>();
+        schema.finish();
+        return schema;
+    }
+
+    bool is_plain() const noexcept {
+        return nodes_[root_].kind == PLAIN;
+    }
+
+    // Value of type is kept as text whenever schema allows
+    bool is_text() const noexcept {
+        return nodes_[root_].kind == TEXT || nodes_[root_].kind == NUMBER_TEXT;
+    }
+
+    const Node& get_root() const noexcept {
+        return nodes_[root_];
+    }
+
+    const Node& get_plain() const noexcept {
+        return nodes_[PLAIN_NODE];
+    }
+
+    const Node& get_items(const Node& node) const noexcept {
+        assert(node.kind == ITEMS);
+        return nodes_[node.children[0]];
+    }
+
+    const Node& get_member(const Node& node, std::string_view name) const noexcept {
+        assert(node.kind == FIELDS);
+        for (size_t i = 0; i < node.names.size(); ++i) {
+            if (node.names[i] == name) {
+                return nodes_[node.children[i]];
+            }
+        }
+        return nodes_[PLAIN_NODE];
+    }
+
+private:
+    friend class SourceSchemaCollector;
+
+    static constexpr size_t PLAIN_NODE = 0;
+
+    SourceSchema() noexcept: nodes_(1, Node{PLAIN, {}, {}}), root_(PLAIN_NODE) {}
+
+    size_t add_node(Kind kind) noexcept {
+        nodes_.push_back(Node{kind, {}, {}});
+        return nodes_.size() - 1;
+    }
+
+    void add_child(size_t node, size_t child) noexcept {
+        nodes_[node].children.push_back(child);
+    }
+
+    template<typename T>
+    size_t add() noexcept {
+        if constexpr (is_optional_v<T>) {
+            return add<typename T::value_type>();
+        } else if constexpr (std::is_same_v<T, RawJson>) {
+            return add_node(TEXT);
+        } else if constexpr (std::is_same_v<T, RawNumber>) {
+            return add_node(NUMBER_TEXT);
+        } else if constexpr (is_model_v<T>) {
+            return add_model<T>();
+        } else if constexpr (is_pointer_v<T>) {
+            return add_model<typename T::element_type>();
+        } else if constexpr (is_vector_v<T>) {
+            size_t node = add_node(ITEMS);
+            add_child(node, add<typename T::value_type>());
+            return node;
+        } else if constexpr (is_map_v<T>) {
+            size_t node = add_node(ITEMS);
+            add_child(node, add<typename T::mapped_type>());
+            return node;
+        } else if constexpr (is_variant_v<T>) {
+            size_t node = add_node(VARIANT);
+            add_alternatives<T>(node, std::make_index_sequence<std::variant_size_v<T>>());
+            return node;
+        } else {
+            return PLAIN_NODE;
+        }
+    }
+
+    template<typename T, size_t... I>
+    void add_alternatives(size_t node, std::index_sequence<I...>) noexcept {
+        (add_child(node, add<std::variant_alternative_t<I, T>>()), ...);
+    }
+
+    template<typename M>
+    size_t add_model() noexcept {
+        for (const auto& [type, node] : models_) {
+            if (type == typeid(M)) {
+                return node;
+            }
+        }
+        size_t node = add_node(FIELDS);
+        models_.emplace_back(typeid(M), node);
+        const M model;
+        SourceSchemaCollector collector(*this, node);
+        model.source_schema_fields_internal(collector);
+        return node;
+    }
+
+    // Nodes which have raw values inside are found iteratively, as models may be recursive. Other nodes become plain
+    void finish() noexcept {
+        std::vector<char> raw(nodes_.size(), false);
+        for (bool changed = true; changed;) {
+            changed = false;
+            for (size_t i = 0; i < nodes_.size(); ++i) {
+                bool is_raw = (nodes_[i].kind == TEXT || nodes_[i].kind == NUMBER_TEXT);
+                for (size_t child : nodes_[i].children) {
+                    is_raw = is_raw || raw[child];
+                }
+                if (is_raw && !raw[i]) {
+                    raw[i] = true;
+                    changed = true;
+                }
+            }
+        }
+        for (size_t i = 0; i < nodes_.size(); ++i) {
+            Node& node = nodes_[i];
+            if (!raw[i] || node.kind == VARIANT) {
+                node.kind = (raw[i] ? TEXT : PLAIN);
+                node.children.clear();
+                node.names.clear();
+            } else if (node.kind == FIELDS) {
+                Node fields{FIELDS, {}, {}};
+                for (size_t j = 0; j < node.children.size(); ++j) {
+                    if (raw[node.children[j]]) {
+                        fields.children.push_back(node.children[j]);
+                        fields.names.push_back(std::move(node.names[j]));
+                    }
+                }
+                node = std::move(fields);
+            }
+        }
+        models_.clear();
+    }
+
+    std::vector<Node> nodes_;
+    size_t root_;
+    // Nodes of models which are already added
+    std::vector<std::pair<std::type_index, size_t>> models_;
+};
+
+template<typename T>
+void SourceSchemaCollector::add_field(const char* name) noexcept {
+    size_t child = schema_.add<T>();
+    schema_.add_child(node_, child);
+    schema_.nodes_[node_].names.emplace_back(name);
+}
+
+// Schema of documents parsed into T, which is a model or any field type
+template<typename T>
+const SourceSchema& get_source_schema() noexcept {
+    static const SourceSchema schema = SourceSchema::build<T>();
+    return schema;
+}
+
+// Builds document same way as rapidjson::Document does, except for values which are kept as strings referring to their
+// text in source, as described by schema. Numbers are read as text, and those which aren't kept are converted by
+// rapidjson as usual
+class SourceHandler : public rapidjson::BaseReaderHandler<rapidjson::UTF8<>, SourceHandler> {
+public:
+    SourceHandler(const char* json, const PositionStream& stream, const SourceSchema& schema,
+                  rapidjson::Document& document, bool patch) noexcept
+        : json_(json), stream_(stream), schema_(schema), document_(document), patch_(patch),
+          member_(&schema.get_plain()), last_(0), text_depth_(0), text_begin_(0) {}
+
+    bool Null() {
+        return scalar(rapidjson::kNullType, [this](size_t) {
+            return document_.Null();
+        });
+    }
+
+    bool Bool(bool value) {
+        return scalar(value ? rapidjson::kTrueType : rapidjson::kFalseType, [this, value](size_t) {
+            return document_.Bool(value);
+        });
+    }
+
+    bool RawNumber(const char* str, rapidjson::SizeType, bool) {
+        return scalar(rapidjson::kNumberType, [this, str](size_t begin) {
+            rapidjson::StringStream number(str);
+            rapidjson::ParseResult result = numbers_.Parse(number, document_);
+            if (result.IsError()) {
+                error_.Set(result.Code(), begin);
+                return false;
+            }
+            return true;
+        });
+    }
+
+    bool String(const char* str, rapidjson::SizeType length, bool copy) {
+        return scalar(rapidjson::kStringType, [this, str, length, copy](size_t) {
+            return document_.String(str, length, copy);
+        });
+    }
+
+    bool Key(const char* str, rapidjson::SizeType length, bool copy) {
+        if (text_depth_ != 0) {
+            return true;
+        }
+        const SourceSchema::Node& object = *containers_.back();
+        if (object.kind == SourceSchema::FIELDS) {
+            member_ = &schema_.get_member(object, std::string_view(str, length));
+        }
+        last_ = stream_.Tell();
+        return document_.Key(str, length, copy);
+    }
+
+    bool StartObject() {
+        return start(rapidjson::kObjectType);
+    }
+
+    bool EndObject(rapidjson::SizeType member_count) {
+        return end(rapidjson::kObjectType, member_count);
+    }
+
+    bool StartArray() {
+        return start(rapidjson::kArrayType);
+    }
+
+    bool EndArray(rapidjson::SizeType element_count) {
+        return end(rapidjson::kArrayType, element_count);
+    }
+
+    // Error of number conversion, which stopped parsing
+    const rapidjson::ParseResult& get_error() const noexcept {
+        return error_;
+    }
+
+private:
+    const SourceSchema::Node& next_node() const noexcept {
+        if (containers_.empty()) {
+            return schema_.get_root();
+        }
+        const SourceSchema::Node& container = *containers_.back();
+        if (container.kind == SourceSchema::ITEMS) {
+            return schema_.get_items(container);
+        }
+        return container.kind == SourceSchema::FIELDS ? *member_ : schema_.get_plain();
+    }
+
+    // Merge patches need null and objects as values, so that raw values are removed and merged
+    bool keeps_text(const SourceSchema::Node& node, rapidjson::Type type) const noexcept {
+        if (node.kind == SourceSchema::TEXT) {
+            return !patch_ || (type != rapidjson::kNullType && type != rapidjson::kObjectType);
+        }
+        return node.kind == SourceSchema::NUMBER_TEXT && type == rapidjson::kNumberType;
+    }
+
+    // Value starts after separators following the previous token
+    size_t get_value_begin() const noexcept {
+        size_t begin = last_;
+        while (json_[begin] == ' ' || json_[begin] == '\n' || json_[begin] == '\r' || json_[begin] == '\t' ||
+               json_[begin] == ':' || json_[begin] == ',') {
+            ++begin;
+        }
+        return begin;
+    }
+
+    bool add_text(size_t begin) {
+        return document_.String(json_ + begin, static_cast<rapidjson::SizeType>(stream_.Tell() - begin), false);
+    }
+
+    template<typename Build>
+    bool scalar(rapidjson::Type type, Build build) {
+        if (text_depth_ != 0) {
+            return true;
+        }
+        size_t begin = get_value_begin();
+        bool result = keeps_text(next_node(), type) ? add_text(begin) : build(begin);
+        last_ = stream_.Tell();
+        return result;
+    }
+
+    bool start(rapidjson::Type type) {
+        if (text_depth_ != 0) {
+            ++text_depth_;
+            return true;
+        }
+        const SourceSchema::Node& node = next_node();
+        if (keeps_text(node, type)) {
+            text_depth_ = 1;
+            text_begin_ = stream_.Tell() - 1;
+            return true;
+        }
+        bool nested = (node.kind == SourceSchema::ITEMS || node.kind == SourceSchema::FIELDS);
+        containers_.push_back(nested ? &node : &schema_.get_plain());
+        last_ = stream_.Tell();
+        return type == rapidjson::kObjectType ? document_.StartObject() : document_.StartArray();
+    }
+
+    bool end(rapidjson::Type type, rapidjson::SizeType count) {
+        if (text_depth_ != 0) {
+            if (--text_depth_ != 0) {
+                return true;
+            }
+            last_ = stream_.Tell();
+            return add_text(text_begin_);
+        }
+        containers_.pop_back();
+        last_ = stream_.Tell();
+        return type == rapidjson::kObjectType ? document_.EndObject(count) : document_.EndArray(count);
+    }
+
+    const char* json_;
+    const PositionStream& stream_;
+    const SourceSchema& schema_;
+    rapidjson::Document& document_;
+    bool patch_;
+    // Nodes of open arrays and objects, and of the last key in object
+    std::vector<const SourceSchema::Node*> containers_;
+    const SourceSchema::Node* member_;
+    // End of the last token
+    size_t last_;
+    // Nesting depth in value which is kept as text, and its start
+    size_t text_depth_;
+    size_t text_begin_;
+    rapidjson::Reader numbers_;
+    rapidjson::ParseResult error_;
+};
+
+// Parses JSON into document, keeping values which are taken by raw fields as text, see SourceSchema. Documents without
+// raw values are parsed by rapidjson as usual. Merge patches keep null and objects, so that they remove and merge
+inline rapidjson::ParseResult parse_source(std::string_view json, const SourceSchema& schema,
+                                           rapidjson::Document& document, bool patch = false) noexcept {
+    if (schema.is_plain()) {
+        return document.Parse(json.data(), json.size());
+    }
+    PositionStream stream(json.data(), json.size());
+    SourceHandler handler(json.data(), stream, schema, document, patch);
+    rapidjson::Reader reader;
+    rapidjson::ParseResult result;
+    auto generator = [&](rapidjson::Document&) noexcept {
+        constexpr unsigned FLAGS = rapidjson::kParseDefaultFlags | rapidjson::kParseNumbersAsStringsFlag;
+        result = reader.Parse<FLAGS>(stream, handler);
+        if (result.Code() == rapidjson::kParseErrorTermination) {
+            result = handler.get_error();
+        }
+        return !result.IsError();
+    };
+    document.Populate(generator);
+    return result;
+}
+
+// Kind of value, which is kept as text
+inline rapidjson::Type get_source_type(std::string_view source) noexcept {
+    switch (source[0]) {
+        case 'n': return rapidjson::kNullType;
+        case 'f': return rapidjson::kFalseType;
+        case 't': return rapidjson::kTrueType;
+        case '{': return rapidjson::kObjectType;
+        case '[': return rapidjson::kArrayType;
+        case '"': return rapidjson::kStringType;
+        default: return rapidjson::kNumberType;
+    }
+}
+
+// Source of a document, which is being parsed into a model on this thread. Raw fields take text of their values from
+// it, as parser keeps them as strings which refer to source. If allocator of document is given, dynamic values are
+// moved out of document instead of being copied
+class ParseContext {
+public:
+    // json must be the source of document, or empty if document isn't parsed from JSON. Document must be allocated
+    // with allocator and must not be used after parsing, if allocator is given
+    explicit ParseContext(std::string_view json, std::shared_ptr<json_allocator_t> allocator = nullptr) noexcept
+        : json_(json), allocator_(std::move(allocator)), previous_(current_) {
+        current_ = this;
+    }
+
+    ParseContext(const ParseContext&) = delete;
+    ParseContext& operator=(const ParseContext&) = delete;
+
+    ~ParseContext() noexcept {
+        current_ = previous_;
+    }
+
+    // Returns source text of value, or empty view if value is not kept as text of document being parsed. Other strings
+    // are copied by parser, so they never point into source
+    static std::string_view find_source(const json_value_t& value) noexcept {
+        if (current_ == nullptr || !value.IsString()) {
+            return std::string_view();
+        }
+        const char* text = value.GetString();
+        std::string_view json = current_->json_;
+        if (std::less<const char*>()(text, json.data()) || !std::less<const char*>()(text, json.data() + json.size())) {
+            return std::string_view();
+        }
+        return std::string_view(text, value.GetStringLength());
+    }
+
+    // Moves value out of document being parsed, together with shared ownership of its allocator. Returns false if
+    // value can't be moved and must be copied
+    static bool take_value(const json_value_t& value, Value& target) noexcept {
+        if (current_ == nullptr || !current_->allocator_ || copy_depth_ != 0) {
+            return false;
+        }
+        // Document is owned by the caller of from_json() and isn't const
+        target.assign(const_cast<json_value_t&>(value), current_->allocator_);
+        return true;
+    }
+
+    // Values are copied while scope exists, e.g. when a variant alternative is tried and the same value may be
+    // parsed again, or when a temporary document is parsed
+    class CopyScope {
+    public:
+        CopyScope() noexcept {
+            ++copy_depth_;
+        }
+
+        CopyScope(const CopyScope&) = delete;
+        CopyScope& operator=(const CopyScope&) = delete;
+
+        ~CopyScope() noexcept {
+            --copy_depth_;
+        }
+    };
+
+private:
+    inline static thread_local ParseContext* current_ = nullptr;
+    inline static thread_local size_t copy_depth_ = 0;
+
+    std::string_view json_;
+    std::shared_ptr<json_allocator_t> allocator_;
+    ParseContext* previous_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_PARSE_CONTEXT_H
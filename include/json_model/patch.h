@@ -0,0 +1,336 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_PATCH_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_PATCH_H
+
+#include "compare.h"
+#include "error.h"
+#include "from_json.h"
+#include "init.h"
+#include "stream.h"
+#include "to_json.h"
+#include "traits.h"
+#include "types.h"
+#include "value.h"
+
+#include "external/rapidjson/document.h"
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace json_model {
+
+// JSON Merge Patch (RFC 7386). Patch is an object with changed members of target, and null for removed ones. Nested
+// objects (models and maps) are patched recursively, other values are replaced. Null values can't be set by merge
+// patch, so null in a map or variant is treated as removal
+
+// Writes merge patch which transforms `source` into `target`
+inline void write_json_diff(json_writer_t& writer, const json_value_t& source, const json_value_t& target) noexcept {
+    if (!source.IsObject() || !target.IsObject()) {
+        target.Accept(writer);
+        return;
+    }
+    writer.StartObject();
+    for (auto iter = source.MemberBegin(); iter != source.MemberEnd(); ++iter) {
+        if (!target.HasMember(iter->name)) {
+            writer.Key(iter->name.GetString(), iter->name.GetStringLength());
+            writer.Null();
+        }
+    }
+    for (auto iter = target.MemberBegin(); iter != target.MemberEnd(); ++iter) {
+        auto source_iter = source.FindMember(iter->name);
+        if (source_iter == source.MemberEnd()) {
+            writer.Key(iter->name.GetString(), iter->name.GetStringLength());
+            iter->value.Accept(writer);
+        } else if (source_iter->value != iter->value) {
+            writer.Key(iter->name.GetString(), iter->name.GetStringLength());
+            write_json_diff(writer, source_iter->value, iter->value);
+        }
+    }
+    writer.EndObject();
+}
+
+inline void merge_json_patch(json_value_t& target, const json_value_t& patch,
+                             rapidjson::Document::AllocatorType& allocator) noexcept {
+    if (!patch.IsObject()) {
+        target.CopyFrom(patch, allocator);
+        return;
+    }
+    if (!target.IsObject()) {
+        target.SetObject();
+    }
+    for (auto iter = patch.MemberBegin(); iter != patch.MemberEnd(); ++iter) {
+        auto target_iter = target.FindMember(iter->name);
+        if (iter->value.IsNull()) {
+            if (target_iter != target.MemberEnd()) {
+                target.EraseMember(target_iter);
+            }
+            continue;
+        }
+        if (target_iter == target.MemberEnd()) {
+            target.AddMember(json_value_t(iter->name, allocator), json_value_t(), allocator);
+            target_iter = target.MemberEnd() - 1;
+        }
+        merge_json_patch(target_iter->value, iter->value, allocator);
+    }
+}
+
+template<typename T>
+void to_document(const T& value, rapidjson::Document& document) noexcept {
+    std::string json;
+    StringSink sink(json);
+    auto stream = std::make_unique<OutputStream>(sink);
+    json_writer_t writer(*stream);
+    to_json(writer, value);
+    writer.Flush();
+    document.Parse(json.c_str(), json.size());
+}
+
+// Writes merge patch while values are compared, so that each pair of values is walked once. Objects of nested models
+// and maps are started only when their first changed member is found, and unchanged ones leave no output
+class DiffWriter {
+public:
+    explicit DiffWriter(json_writer_t& writer) noexcept: writer_(writer), started_(0) {}
+
+    json_writer_t& get_writer() noexcept {
+        return writer_;
+    }
+
+    void open(const char* key, size_t length) noexcept {
+        pending_.emplace_back(key, length);
+    }
+
+    void close() noexcept {
+        if (started_ == pending_.size()) {
+            writer_.EndObject();
+            --started_;
+        }
+        pending_.pop_back();
+    }
+
+    // Writes key of changed member, after keys of objects which contain it
+    json_writer_t& change(const char* key, size_t length) noexcept {
+        for (; started_ < pending_.size(); ++started_) {
+            writer_.Key(pending_[started_].first, static_cast<rapidjson::SizeType>(pending_[started_].second));
+            writer_.StartObject();
+        }
+        writer_.Key(key, static_cast<rapidjson::SizeType>(length));
+        return writer_;
+    }
+
+private:
+    json_writer_t& writer_;
+    // Keys of objects which are open, first `started_` of them are written
+    std::vector<std::pair<const char*, size_t>> pending_;
+    size_t started_;
+};
+
+// Writes patch of member `key` which transforms `source` into `target`, if they are different
+template<typename T>
+void write_diff(DiffWriter& diff_writer, const char* key, size_t length, const T& source, const T& target) noexcept {
+    if constexpr (is_optional_v<T>) {
+        if (!target.has_value()) {
+            if (source.has_value()) {
+                diff_writer.change(key, length).Null();
+            }
+        } else if (!source.has_value()) {
+            to_json(diff_writer.change(key, length), target.value());
+        } else {
+            write_diff(diff_writer, key, length, source.value(), target.value());
+        }
+    } else if constexpr (is_pointer_v<T>) {
+        diff_writer.open(key, length);
+        source->diff_internal(*target, diff_writer);
+        diff_writer.close();
+    } else if constexpr (is_map_v<T>) {
+        diff_writer.open(key, length);
+        for (const auto& item : source) {
+            if (target.find(item.first) == target.end()) {
+                diff_writer.change(item.first.c_str(), item.first.size()).Null();
+            }
+        }
+        for (const auto& item : target) {
+            auto iter = source.find(item.first);
+            if (iter == source.end()) {
+                to_json(diff_writer.change(item.first.c_str(), item.first.size()), item.second);
+            } else {
+                write_diff(diff_writer, item.first.c_str(), item.first.size(), iter->second, item.second);
+            }
+        }
+        diff_writer.close();
+    } else if constexpr (is_variant_v<T>) {
+        if (source.index() == target.index()) {
+            std::visit(
+                [&](auto&& source_arg, auto&& target_arg) noexcept {
+                    if constexpr (std::is_same_v<std::decay_t<decltype(source_arg)>, std::decay_t<decltype(target_arg)>>) {
+                        write_diff(diff_writer, key, length, source_arg, target_arg);
+                    }
+                }, source, target
+            );
+        } else {
+            // Different alternatives may both be objects, so members of source which are absent in target are removed
+            rapidjson::Document source_document;
+            rapidjson::Document target_document;
+            to_document(source, source_document);
+            to_document(target, target_document);
+            write_json_diff(diff_writer.change(key, length), source_document, target_document);
+        }
+    } else if constexpr (std::is_same_v<T, RawJson>) {
+        if (source != target) {
+            rapidjson::Document source_document;
+            rapidjson::Document target_document;
+            source_document.Parse(source.get_text().data(), source.get_text().size());
+            target_document.Parse(target.get_text().data(), target.get_text().size());
+            write_json_diff(diff_writer.change(key, length), source_document, target_document);
+        }
+    } else if constexpr (std::is_same_v<T, Value>) {
+        if (source != target) {
+            write_json_diff(diff_writer.change(key, length), source.get_value(), target.get_value());
+        }
+    } else if (!values_equal(source, target)) {
+        // Other values, including vectors, are written whole
+        to_json(diff_writer.change(key, length), target);
+    }
+}
+
+class FieldDiff : public FieldPairs {
+public:
+    template<typename M>
+    FieldDiff(DiffWriter& diff_writer, const M& source, const M& target) noexcept
+        : FieldPairs(source, target), diff_writer_(diff_writer) {}
+
+    template<typename T>
+    void diff(const char* name, const T& source, const T& target, int max_decimal_places) noexcept {
+        json_writer_t& writer = diff_writer_.get_writer();
+        int saved_max_decimal_places = writer.GetMaxDecimalPlaces();
+        writer.SetMaxDecimalPlaces(max_decimal_places);
+        write_diff(diff_writer_, name, std::strlen(name), source, target);
+        writer.SetMaxDecimalPlaces(saved_max_decimal_places);
+    }
+
+private:
+    DiffWriter& diff_writer_;
+};
+
+// Applies patch to value in place. Patch must not be null, null members of patched objects are handled by caller
+template<typename T>
+bool apply_patch_value(T& value, const json_value_t& patch, bool throw_on_error) {
+    if constexpr (is_optional_v<T>) {
+        if (value.has_value()) {
+            return apply_patch_value(value.value(), patch, throw_on_error);
+        }
+        value.emplace();
+        initialize(value.value());
+        return from_json(patch, value.value(), throw_on_error);
+    } else if constexpr (is_pointer_v<T>) {
+        return value->apply_patch_internal(patch, throw_on_error);
+    } else if constexpr (is_map_v<T>) {
+        if (!patch.IsObject()) {
+            if (throw_on_error) {
+                throw TypeMismatchError("object", patch.GetType());
+            }
+            return false;
+        }
+        for (auto iter = patch.MemberBegin(); iter != patch.MemberEnd(); ++iter) {
+            std::string key(iter->name.GetString(), iter->name.GetStringLength());
+            if (iter->value.IsNull()) {
+                value.erase(key);
+                continue;
+            }
+            // New items are parsed from scratch
+            auto item = value.find(key);
+            bool is_new = (item == value.end());
+            if (is_new) {
+                item = value.emplace(key, typename T::mapped_type()).first;
+                initialize(item->second);
+            }
+            if (throw_on_error) {
+                try {
+                    if (is_new) {
+                        from_json(iter->value, item->second, true);
+                    } else {
+                        apply_patch_value(item->second, iter->value, true);
+                    }
+                } catch (SchemaError& error) {
+                    error.add_trace_key(key);
+                    throw;
+                }
+            } else if (!(is_new ? from_json(iter->value, item->second, false)
+                                : apply_patch_value(item->second, iter->value, false))) {
+                return false;
+            }
+        }
+        return true;
+    } else if constexpr (is_variant_v<T> || std::is_same_v<T, RawJson>) {
+        if (!patch.IsObject()) {
+            return from_json(patch, value, throw_on_error);
+        }
+        // Object patch is merged into JSON of current value, and the result is parsed as any alternative
+        rapidjson::Document document;
+        to_document(value, document);
+        merge_json_patch(document, patch, document.GetAllocator());
+        ParseContext::CopyScope copy_scope;
+        return from_json(document, value, throw_on_error);
+    } else if constexpr (std::is_same_v<T, Value>) {
+        merge_json_patch(value.get_value(), patch, value.get_allocator());
+        return true;
+    } else {
+        return from_json(patch, value, throw_on_error);
+    }
+}
+
+class PatchApplier {
+public:
+    PatchApplier(const json_value_t& patch, bool throw_on_error) noexcept
+        : patch_(patch), throw_on_error_(throw_on_error), failed_(false) {}
+
+    template<typename T>
+    void apply(const char* name, T& value) const {
+        if (failed_) return;
+        auto iter = patch_.FindMember(name);
+        if (iter == patch_.MemberEnd()) return;
+
+        if (iter->value.IsNull()) {
+            if constexpr (is_optional_v<T>) {
+                value.reset();
+            } else {
+                failed_ = true;
+                if (throw_on_error_) {
+                    throw MissingKeyError(name);
+                }
+            }
+            return;
+        }
+
+        if (throw_on_error_) {
+            try {
+                apply_patch_value(value, iter->value, true);
+            } catch (SchemaError& error) {
+                error.add_trace_key(name);
+                throw;
+            }
+        } else if (!apply_patch_value(value, iter->value, false)) {
+            failed_ = true;
+        }
+    }
+
+    bool is_failed() const noexcept {
+        return failed_;
+    }
+
+private:
+    const json_value_t& patch_;
+    bool throw_on_error_;
+    mutable bool failed_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_PATCH_H
@@ -0,0 +1,225 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_POOL_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_POOL_H
+
+#include "model.h"
+#include "traits.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace json_model {
+
+// Pool of constructed models. Released models are reset to the state of newly constructed ones, but keep capacity of
+// their strings and containers and keep their nested models. Free models are cached in slots of the pool, one per
+// thread (threads beyond SLOT_COUNT share slots), which overflow to a lock-free free list of the pool in batches. Pool
+// must outlive all models acquired from it, and frees all its models when destroyed
+template<typename M>
+class Pool {
+    static_assert(is_model_v<M>);
+
+    // Free list is a stack of batches, each of them is a chain of nodes linked by `next`
+    struct Node {
+        M model;
+        Node* next = nullptr;
+        Node* next_batch = nullptr;
+    };
+
+public:
+    static constexpr size_t SLOT_COUNT = 64;
+    static constexpr size_t LOCAL_CACHE_SIZE = 64;
+    // Nodes are moved between slots and the free list in batches of at most this size
+    static constexpr size_t BATCH_SIZE = LOCAL_CACHE_SIZE / 2;
+
+    // Owns acquired model and returns it to the pool on destruction
+    class Handle {
+    public:
+        Handle() noexcept: pool_(nullptr), node_(nullptr) {}
+        Handle(const Handle&) = delete;
+        Handle& operator=(const Handle&) = delete;
+
+        Handle(Handle&& other) noexcept: pool_(other.pool_), node_(std::exchange(other.node_, nullptr)) {}
+
+        Handle& operator=(Handle&& other) noexcept {
+            if (this != &other) {
+                release();
+                pool_ = other.pool_;
+                node_ = std::exchange(other.node_, nullptr);
+            }
+            return *this;
+        }
+
+        ~Handle() noexcept {
+            release();
+        }
+
+        M* get() const noexcept {
+            return node_ != nullptr ? &node_->model : nullptr;
+        }
+
+        M& operator*() const noexcept {
+            assert(node_);
+            return node_->model;
+        }
+
+        M* operator->() const noexcept {
+            assert(node_);
+            return &node_->model;
+        }
+
+        explicit operator bool() const noexcept {
+            return node_ != nullptr;
+        }
+
+        void release() noexcept {
+            if (node_ != nullptr) {
+                pool_->release(std::exchange(node_, nullptr));
+            }
+        }
+
+    private:
+        friend class Pool;
+
+        Handle(Pool* pool, Node* node) noexcept: pool_(pool), node_(node) {}
+
+        Pool* pool_;
+        Node* node_;
+    };
+
+    // Constructs `size` models in advance
+    explicit Pool(size_t size = 0): slots_(new Slot[SLOT_COUNT]), head_(nullptr), popping_(false) {
+        for (size_t i = 0; i < size; i += BATCH_SIZE) {
+            Node* first = new Node();
+            Node* last = first;
+            for (size_t j = i + 1; j < std::min(size, i + BATCH_SIZE); ++j) {
+                last = last->next = new Node();
+            }
+            push(first);
+        }
+    }
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    ~Pool() noexcept {
+        for (size_t i = 0; i < SLOT_COUNT; ++i) {
+            for (size_t j = 0; j < slots_[i].size; ++j) {
+                delete slots_[i].nodes[j];
+            }
+        }
+        Node* batch = head_.exchange(nullptr);
+        while (batch != nullptr) {
+            Node* node = std::exchange(batch, batch->next_batch);
+            while (node != nullptr) {
+                delete std::exchange(node, node->next);
+            }
+        }
+    }
+
+    // Throws std::bad_alloc if a new model can't be allocated
+    [[nodiscard]] Handle acquire() {
+        Slot& slot = get_slot();
+        Node* node = nullptr;
+        if (slot.try_lock()) {
+            if (slot.size == 0) {
+                refill(slot);
+            }
+            if (slot.size != 0) {
+                node = slot.nodes[--slot.size];
+            }
+            slot.unlock();
+        }
+        if (node == nullptr) {
+            node = new Node();
+        }
+        return Handle(this, node);
+    }
+
+private:
+    // Slot is locked only by threads which share it, so locking almost never waits. Contended slot is skipped
+    struct alignas(64) Slot {
+        bool try_lock() noexcept {
+            return !locked.exchange(true, std::memory_order_acquire);
+        }
+
+        void unlock() noexcept {
+            locked.store(false, std::memory_order_release);
+        }
+
+        std::atomic<bool> locked = false;
+        size_t size = 0;
+        Node* nodes[LOCAL_CACHE_SIZE] = {};
+    };
+
+    // Threads are spread over slots once, in order of their first use of any pool
+    Slot& get_slot() const noexcept {
+        static std::atomic<size_t> next_index(0);
+        thread_local size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % SLOT_COUNT;
+        return slots_[index];
+    }
+
+    void release(Node* node) noexcept {
+        node->model.reset_internal();
+        Slot& slot = get_slot();
+        if (!slot.try_lock()) {
+            node->next = nullptr;
+            push(node);
+            return;
+        }
+        if (slot.size == LOCAL_CACHE_SIZE) {
+            // Half of the cache is moved to the free list, so that it isn't flushed on every release
+            for (size_t i = LOCAL_CACHE_SIZE - BATCH_SIZE; i + 1 < LOCAL_CACHE_SIZE; ++i) {
+                slot.nodes[i]->next = slot.nodes[i + 1];
+            }
+            slot.nodes[LOCAL_CACHE_SIZE - 1]->next = nullptr;
+            push(slot.nodes[LOCAL_CACHE_SIZE - BATCH_SIZE]);
+            slot.size = LOCAL_CACHE_SIZE - BATCH_SIZE;
+        }
+        slot.nodes[slot.size++] = node;
+        slot.unlock();
+    }
+
+    // Pops batches while the slot is less than half full. Pushes never block popping, and pops are serialized, so that
+    // the stack isn't prone to ABA problem: a batch can't be popped and pushed again while it is being popped. Thread
+    // which finds another one popping allocates a new model instead of waiting
+    void refill(Slot& slot) noexcept {
+        if (popping_.exchange(true, std::memory_order_acquire)) {
+            return;
+        }
+        while (slot.size < LOCAL_CACHE_SIZE - BATCH_SIZE) {
+            Node* batch = head_.load(std::memory_order_acquire);
+            while (batch != nullptr && !head_.compare_exchange_weak(batch, batch->next_batch,
+                                                                     std::memory_order_acquire)) {}
+            if (batch == nullptr) {
+                break;
+            }
+            for (Node* node = batch; node != nullptr; node = node->next) {
+                slot.nodes[slot.size++] = node;
+            }
+        }
+        popping_.store(false, std::memory_order_release);
+    }
+
+    // Pushes batch of at most BATCH_SIZE nodes to the free list
+    void push(Node* batch) noexcept {
+        batch->next_batch = head_.load(std::memory_order_relaxed);
+        while (!head_.compare_exchange_weak(batch->next_batch, batch, std::memory_order_release,
+                                            std::memory_order_relaxed)) {}
+    }
+
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<Node*> head_;
+    std::atomic<bool> popping_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_POOL_H
@@ -0,0 +1,262 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_PUSH_PARSER_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_PUSH_PARSER_H
+
+#include "model.h"
+#include "error.h"
+#include "parse_context.h"
+#include "value.h"
+
+#include "external/rapidjson/document.h"
+#include "external/rapidjson/reader.h"
+#include "external/rapidjson/error/en.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace json_model {
+
+// Stream over the unparsed tail of previous chunks followed by the current chunk. Stream ends at `limit`, which is
+// counted from the beginning of tail
+class ChunkStream {
+public:
+    using Ch = char;
+
+    ChunkStream(const std::string& tail, const char* chunk, size_t limit, size_t offset) noexcept
+        : tail_(tail.data()), tail_size_(tail.size()), chunk_(chunk), limit_(limit), offset_(offset), position_(0) {}
+
+    char Peek() const noexcept {
+        if (position_ < tail_size_) {
+            return tail_[position_];
+        }
+        return position_ < limit_ ? chunk_[position_ - tail_size_] : '\0';
+    }
+
+    char Take() noexcept {
+        char c = Peek();
+        if (position_ < limit_) {
+            ++position_;
+        }
+        return c;
+    }
+
+    // Offset in the whole document
+    size_t Tell() const noexcept {
+        return offset_ + position_;
+    }
+
+    size_t get_position() const noexcept {
+        return position_;
+    }
+
+    char* PutBegin() noexcept {
+        assert(false);
+        return nullptr;
+    }
+
+    void Put(char) noexcept {
+        assert(false);
+    }
+
+    void Flush() noexcept {}
+
+    size_t PutEnd(char*) noexcept {
+        assert(false);
+        return 0;
+    }
+
+private:
+    const char* tail_;
+    size_t tail_size_;
+    const char* chunk_;
+    size_t limit_;
+    size_t offset_;
+    size_t position_;
+};
+
+// Parses JSON received in chunks into model, without concatenating them. Each chunk is tokenized as it arrives, up to
+// the last position where no token is split, and only the rest of the chunk is kept until the next one. Document is
+// built token by token and assigned to model by finish(), so that model isn't left half-parsed. As the whole source
+// is never kept, raw fields get compact JSON of their values, same as with binary formats. Numbers are converted as
+// they are read, so RawNumber fields get shortest form of the parsed double instead of their text, and numbers out of
+// double range are rejected, unlike with from_json().
+// On error json_model::Exception is thrown or false returned. Parser can't be used after an error or finish()
+class PushParser {
+public:
+    explicit PushParser(Model& model, bool throw_on_error = true) noexcept
+        : model_(model), throw_on_error_(throw_on_error), allocator_(std::make_shared<json_allocator_t>()),
+          document_(allocator_.get()), offset_(0), in_string_(false), escaped_(false), last_('\0'), finished_(false) {
+        reader_.IterativeParseInit();
+    }
+
+    PushParser(const PushParser&) = delete;
+    PushParser& operator=(const PushParser&) = delete;
+
+    bool feed(const char* data, size_t size) {
+        if (finished_) {
+            return false;
+        }
+        size_t limit = find_token_boundary(data, size);
+        ChunkStream stream(tail_, data, limit, offset_);
+        if (!parse(stream, limit, data, size)) {
+            return false;
+        }
+
+        // Unparsed bytes are moved to the beginning of tail
+        size_t position = stream.get_position();
+        if (position < tail_.size()) {
+            tail_.erase(0, position);
+            tail_.append(data, size);
+        } else {
+            tail_.assign(data + (position - tail_.size()), size - (position - tail_.size()));
+        }
+        offset_ += position;
+        if (reader_.IterativeParseComplete()) {
+            return check_trailing();
+        }
+        return true;
+    }
+
+    bool feed(const std::string& data) {
+        return feed(data.data(), data.size());
+    }
+
+    // Parses the rest of input and assigns document to model
+    bool finish() {
+        if (finished_) {
+            return false;
+        }
+        ChunkStream stream(tail_, nullptr, tail_.size(), offset_);
+        if (!parse(stream, tail_.size(), nullptr, 0)) {
+            return false;
+        }
+        if (!reader_.IterativeParseComplete()) {
+            // End of input is reported by reader
+            reader_.IterativeParseNext<FLAGS>(stream, document_);
+            return fail(reader_.GetParseErrorCode(), reader_.GetErrorOffset(), nullptr, 0);
+        }
+
+        auto populated = [](rapidjson::Document&) noexcept {
+            return true;
+        };
+        document_.Populate(populated);
+        ParseContext context(std::string_view(), allocator_);
+        finished_ = true;
+        return model_.from_json_internal(document_, throw_on_error_);
+    }
+
+private:
+    static constexpr unsigned FLAGS = rapidjson::kParseStopWhenDoneFlag;
+
+    // Parses tokens before `end`, which is offset in stream
+    bool parse(ChunkStream& stream, size_t end, const char* data, size_t size) {
+        while (stream.get_position() < end && !reader_.IterativeParseComplete()) {
+            if (!reader_.IterativeParseNext<FLAGS>(stream, document_)) {
+                return fail(reader_.GetParseErrorCode(), reader_.GetErrorOffset(), data, size);
+            }
+        }
+        return true;
+    }
+
+    // Returns offset of the last boundary in tail and chunk, or 0 if chunk has none, as tail doesn't have any either.
+    // Boundary is placed after a complete string or bracket, or before a separator which follows a number or literal,
+    // and never after a comma or colon, as reader would take end of input after a separator for an error
+    size_t find_token_boundary(const char* data, size_t size) noexcept {
+        size_t boundary = 0;
+        for (size_t i = 0; i < size; ++i) {
+            char c = data[i];
+            if (in_string_) {
+                if (escaped_) {
+                    escaped_ = false;
+                } else if (c == '\\') {
+                    escaped_ = true;
+                } else if (c == '"') {
+                    in_string_ = false;
+                    boundary = tail_.size() + i + 1;
+                }
+                last_ = c;
+                continue;
+            }
+            switch (c) {
+                case '"':
+                    in_string_ = true;
+                    break;
+                case '{':
+                case '[':
+                case '}':
+                case ']':
+                    boundary = tail_.size() + i + 1;
+                    break;
+                case ',':
+                case ':':
+                case ' ':
+                case '\t':
+                case '\n':
+                case '\r':
+                    if (is_literal_char(last_)) {
+                        boundary = tail_.size() + i;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            last_ = c;
+        }
+        return boundary;
+    }
+
+    static bool is_literal_char(char c) noexcept {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '.' || c == '-' ||
+               c == '+';
+    }
+
+    // Only whitespace may follow the document
+    bool check_trailing() {
+        for (size_t i = 0; i < tail_.size(); ++i) {
+            char c = tail_[i];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+                return fail(rapidjson::kParseErrorDocumentRootNotSingular, offset_ + i, nullptr, 0);
+            }
+        }
+        offset_ += tail_.size();
+        tail_.clear();
+        return true;
+    }
+
+    // Error is shown with the tail and the current chunk, which is all of the source that is left
+    bool fail(rapidjson::ParseErrorCode code, size_t offset, const char* data, size_t size) {
+        finished_ = true;
+        if (throw_on_error_) {
+            std::string source = tail_;
+            if (data != nullptr) {
+                source.append(data, size);
+            }
+            offset = std::min(offset, offset_ + source.size());
+            throw ParseError(source, offset_, offset, rapidjson::GetParseError_En(code));
+        }
+        return false;
+    }
+
+    Model& model_;
+    bool throw_on_error_;
+    std::shared_ptr<json_allocator_t> allocator_;
+    rapidjson::Document document_;
+    rapidjson::Reader reader_;
+    std::string tail_;
+    // Offset of tail in the whole document
+    size_t offset_;
+    bool in_string_;
+    bool escaped_;
+    char last_;
+    bool finished_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_PUSH_PARSER_H
@@ -0,0 +1,184 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_RAW_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_RAW_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+namespace json_model {
+
+// Number, which keeps its text from JSON and is written back verbatim, so that decimals and integers of any size don't
+// lose precision. Text is converted only by accessors below
+class RawNumber {
+public:
+    RawNumber() noexcept: text_("0") {}
+
+    // Text must be a valid JSON number
+    explicit RawNumber(std::string_view text) noexcept: text_(text) {}
+
+    const std::string& get_text() const noexcept {
+        return text_;
+    }
+
+    // Reuses capacity of text
+    void set_text(std::string_view text) noexcept {
+        text_.assign(text.data(), text.size());
+    }
+
+    // Return false if number is not an integer or is out of range
+    bool to_int64(int64_t& value) const noexcept {
+        return parse_integer(value);
+    }
+
+    bool to_uint64(uint64_t& value) const noexcept {
+        return parse_integer(value);
+    }
+
+    double to_double() const noexcept {
+        double value = 0;
+#if defined(__cpp_lib_to_chars)
+        std::from_chars(text_.data(), text_.data() + text_.size(), value);
+#else
+        value = std::strtod(text_.c_str(), nullptr);
+#endif
+        return value;
+    }
+
+    // Number multiplied by 10^scale, e.g. 12.345 with scale 3 is 12345. Returns false if result is not an integer or
+    // doesn't fit int64_t
+    bool to_fixed(unsigned scale, int64_t& value) const noexcept {
+        std::string_view text = text_;
+        bool negative = (!text.empty() && text[0] == '-');
+        if (negative) {
+            text.remove_prefix(1);
+        }
+        int64_t shift = scale;
+        size_t exponent_pos = text.find_first_of("eE");
+        if (exponent_pos != std::string_view::npos) {
+            std::string_view exponent_text = text.substr(exponent_pos + 1);
+            if (!exponent_text.empty() && exponent_text[0] == '+') {
+                exponent_text.remove_prefix(1);
+            }
+            int exponent = 0;
+            auto [end, error] = std::from_chars(exponent_text.data(), exponent_text.data() + exponent_text.size(), exponent);
+            if (error != std::errc() || end != exponent_text.data() + exponent_text.size()) {
+                return false;
+            }
+            shift += exponent;
+            text = text.substr(0, exponent_pos);
+        }
+        size_t point_pos = text.find('.');
+        std::string_view integer = text.substr(0, point_pos);
+        std::string_view fraction = (point_pos == std::string_view::npos ? std::string_view() : text.substr(point_pos + 1));
+        shift -= static_cast<int64_t>(fraction.size());
+
+        // Digits past the last kept one must be zeros
+        size_t digits = integer.size() + fraction.size();
+        size_t kept = digits;
+        if (shift < 0) {
+            auto dropped = static_cast<size_t>(-shift);
+            kept = (dropped < digits ? digits - dropped : 0);
+        }
+        uint64_t magnitude = 0;
+        for (size_t i = 0; i < digits; ++i) {
+            auto digit = static_cast<unsigned>((i < integer.size() ? integer[i] : fraction[i - integer.size()]) - '0');
+            if (i >= kept) {
+                if (digit != 0) {
+                    return false;
+                }
+            } else if (magnitude > (UINT64_MAX - digit) / 10) {
+                return false;
+            } else {
+                magnitude = magnitude * 10 + digit;
+            }
+        }
+        for (; shift > 0 && magnitude != 0; --shift) {
+            if (magnitude > UINT64_MAX / 10) {
+                return false;
+            }
+            magnitude *= 10;
+        }
+
+        if (magnitude > static_cast<uint64_t>(INT64_MAX) + (negative ? 1 : 0)) {
+            return false;
+        }
+        value = (negative && magnitude != 0 ? -static_cast<int64_t>(magnitude - 1) - 1 : static_cast<int64_t>(magnitude));
+        return true;
+    }
+
+    // Inverse of to_fixed(), e.g. 12345 with scale 3 is 12.345
+    static RawNumber from_fixed(int64_t value, unsigned scale) noexcept {
+        uint64_t magnitude = (value < 0 ? static_cast<uint64_t>(-(value + 1)) + 1 : static_cast<uint64_t>(value));
+        std::string digits = std::to_string(magnitude);
+        if (digits.size() <= scale) {
+            digits.insert(0, scale + 1 - digits.size(), '0');
+        }
+        if (scale != 0) {
+            digits.insert(digits.size() - scale, 1, '.');
+        }
+        if (value < 0) {
+            digits.insert(0, 1, '-');
+        }
+        return RawNumber(digits);
+    }
+
+    bool operator==(const RawNumber& other) const noexcept {
+        return text_ == other.text_;
+    }
+
+    bool operator!=(const RawNumber& other) const noexcept {
+        return text_ != other.text_;
+    }
+
+private:
+    template<typename T>
+    bool parse_integer(T& value) const noexcept {
+        auto [end, error] = std::from_chars(text_.data(), text_.data() + text_.size(), value);
+        return error == std::errc() && end == text_.data() + text_.size();
+    }
+
+    std::string text_;
+};
+
+// JSON value of any type, which is kept as text and written back verbatim. Use it for sub-documents which are only
+// passed through, so that they are not parsed into models and serialized again
+class RawJson {
+public:
+    RawJson() noexcept: text_("null") {}
+
+    // Text must be a valid JSON value
+    explicit RawJson(std::string_view text) noexcept: text_(text) {}
+
+    const std::string& get_text() const noexcept {
+        return text_;
+    }
+
+    // Reuses capacity of text
+    void set_text(std::string_view text) noexcept {
+        text_.assign(text.data(), text.size());
+    }
+
+    // Values are compared as text, so equal values with different formatting are different
+    bool operator==(const RawJson& other) const noexcept {
+        return text_ == other.text_;
+    }
+
+    bool operator!=(const RawJson& other) const noexcept {
+        return text_ != other.text_;
+    }
+
+private:
+    std::string text_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_RAW_H
@@ -0,0 +1,192 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_SIZE_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_SIZE_H
+
+#include "escape.h"
+#include "traits.h"
+#include "value.h"
+#include "writer.h"
+
+#include <type_traits>
+
+namespace json_model {
+
+// Functions below compute size of JSON produced by to_json(). The result is exact, except for doubles, for which
+// the longest possible representation is assumed
+
+inline constexpr size_t DOUBLE_MAX_JSON_SIZE = 25;
+
+inline size_t string_json_size(const char* str, size_t length) noexcept {
+    // Number of extra characters required to escape each character, see write_escape()
+    static constexpr unsigned char extra[32] = {
+        5, 5, 5, 5, 5, 5, 5, 5, 1, 1, 1, 5, 1, 1, 5, 5,
+        5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    };
+    size_t result = length + 2;
+    const char* end = str + length;
+    while ((str = find_escape(str, end)) != end) {
+        auto c = static_cast<unsigned char>(*str++);
+        result += (c < 0x20 ? extra[c] : 1);
+    }
+    return result;
+}
+
+template<typename T>
+size_t integer_json_size(T value) noexcept {
+    size_t result = 1;
+    std::make_unsigned_t<T> abs_value;
+    if constexpr (std::is_signed_v<T>) {
+        if (value < 0) {
+            result++;
+            abs_value = static_cast<std::make_unsigned_t<T>>(0) - static_cast<std::make_unsigned_t<T>>(value);
+        } else {
+            abs_value = static_cast<std::make_unsigned_t<T>>(value);
+        }
+    } else {
+        abs_value = value;
+    }
+    while (abs_value >= 10) {
+        abs_value /= 10;
+        result++;
+    }
+    return result;
+}
+
+inline size_t json_value_size(const json_value_t& value) noexcept {
+    if (value.IsNull()) {
+        return 4;
+    } else if (value.IsBool()) {
+        return value.GetBool() ? 4 : 5;
+    } else if (value.IsInt64()) {
+        return integer_json_size(value.GetInt64());
+    } else if (value.IsUint64()) {
+        return integer_json_size(value.GetUint64());
+    } else if (value.IsNumber()) {
+        return DOUBLE_MAX_JSON_SIZE;
+    } else if (value.IsString()) {
+        return string_json_size(value.GetString(), value.GetStringLength());
+    } else if (value.IsArray()) {
+        // Brackets and commas
+        size_t result = 2 + (value.Empty() ? 0 : value.Size() - 1);
+        for (const auto& item : value.GetArray()) {
+            result += json_value_size(item);
+        }
+        return result;
+    } else {
+        // Braces, commas and colons
+        size_t result = 2 + (value.ObjectEmpty() ? 0 : 2 * value.MemberCount() - 1);
+        for (auto iter = value.MemberBegin(); iter != value.MemberEnd(); ++iter) {
+            result += string_json_size(iter->name.GetString(), iter->name.GetStringLength());
+            result += json_value_size(iter->value);
+        }
+        return result;
+    }
+}
+
+template<typename T>
+typename std::enable_if_t<is_primitive_v<T>, size_t>
+json_size(const T& value) noexcept {
+    if constexpr (is_enum_v<T>) {
+        return get_enum_literal(value).size() - 1;
+    } else if constexpr (std::is_same_v<T, bool>) {
+        return value ? 4 : 5;
+    } else if constexpr (std::is_same_v<T, double>) {
+        return DOUBLE_MAX_JSON_SIZE;
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        return string_json_size(value.data(), value.size());
+    } else if constexpr (std::is_same_v<T, Bytes>) {
+        return base64_encoded_size(value.size()) + 2;
+    } else if constexpr (std::is_same_v<T, RawNumber> || std::is_same_v<T, RawJson>) {
+        return value.get_text().size();
+    } else if constexpr (std::is_same_v<T, Value>) {
+        return json_value_size(value.get_value());
+    } else if constexpr (std::is_same_v<T, std::nullptr_t>) {
+        return 4;
+    } else {
+        return integer_json_size(value);
+    }
+}
+
+template<typename T>
+typename std::enable_if_t<is_pointer_v<T>, size_t>
+json_size(const T& value) noexcept {
+    assert(value);
+    return value->json_size_internal();
+}
+
+template<typename T>
+typename std::enable_if_t<is_map_v<T>, size_t>
+json_size(const T& value) noexcept;
+
+template<typename T>
+typename std::enable_if_t<is_variant_v<T>, size_t>
+json_size(const T& value) noexcept;
+
+template<typename T>
+typename std::enable_if_t<is_vector_v<T>, size_t>
+json_size(const T& value) noexcept {
+    size_t result = 2;
+    for (size_t i = 0; i < value.size(); ++i) {
+        result += json_size(value[i]);
+    }
+    if (!value.empty()) {
+        result += value.size() - 1;
+    }
+    return result;
+}
+
+template<typename T>
+typename std::enable_if_t<is_map_v<T>, size_t>
+json_size(const T& value) noexcept {
+    size_t result = 2;
+    for (const auto& item : value) {
+        result += string_json_size(item.first.data(), item.first.size()) + 1;
+        result += json_size(item.second);
+    }
+    if (!value.empty()) {
+        result += value.size() - 1;
+    }
+    return result;
+}
+
+template<typename T>
+typename std::enable_if_t<is_variant_v<T>, size_t>
+json_size(const T& value) noexcept {
+    assert(!value.valueless_by_exception());
+    return std::visit(
+        [](auto&& arg) noexcept {
+            return json_size(arg);
+        }, value
+    );
+}
+
+class SizeCounter {
+public:
+    explicit SizeCounter(const KeyTable& keys) noexcept: next_key_(keys.data()), size_(2), first_(true) {}
+
+    const FieldKey& next_key() noexcept {
+        return *next_key_++;
+    }
+
+    void add_member(const FieldKey& key, size_t value_size) noexcept {
+        // Comma is stored in key and is omitted for the first member, colon is not stored
+        size_ += key.size() + value_size + (first_ ? 0 : 1);
+        first_ = false;
+    }
+
+    size_t get_size() const noexcept {
+        return size_;
+    }
+
+private:
+    const FieldKey* next_key_;
+    size_t size_;
+    bool first_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_SIZE_H
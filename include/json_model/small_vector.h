@@ -0,0 +1,263 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_SMALL_VECTOR_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_SMALL_VECTOR_H
+
+#include <cassert>
+#include <cstddef>
+#include <initializer_list>
+#include <new>
+#include <utility>
+
+namespace json_model {
+
+// Vector which keeps up to N elements inline and moves them to heap when it grows larger. Can be used as a field or
+// container element in place of std::vector
+template<typename T, size_t N>
+class SmallVector {
+    static_assert(N > 0);
+
+public:
+    using value_type = T;
+    using size_type = size_t;
+    using reference = T&;
+    using const_reference = const T&;
+    using iterator = T*;
+    using const_iterator = const T*;
+
+    SmallVector() noexcept: data_(get_inline_data()), size_(0), capacity_(N) {}
+
+    SmallVector(std::initializer_list<T> items) noexcept: SmallVector() {
+        reserve(items.size());
+        for (const T& item : items) {
+            new (data_ + size_++) T(item);
+        }
+    }
+
+    SmallVector(const SmallVector& other) noexcept: SmallVector() {
+        copy_from(other);
+    }
+
+    SmallVector(SmallVector&& other) noexcept: SmallVector() {
+        move_from(other);
+    }
+
+    SmallVector& operator=(const SmallVector& other) noexcept {
+        if (this != &other) {
+            clear();
+            copy_from(other);
+        }
+        return *this;
+    }
+
+    SmallVector& operator=(SmallVector&& other) noexcept {
+        if (this != &other) {
+            clear();
+            deallocate();
+            move_from(other);
+        }
+        return *this;
+    }
+
+    ~SmallVector() noexcept {
+        clear();
+        deallocate();
+    }
+
+    size_t size() const noexcept {
+        return size_;
+    }
+
+    size_t capacity() const noexcept {
+        return capacity_;
+    }
+
+    bool empty() const noexcept {
+        return size_ == 0;
+    }
+
+    // Elements are stored inline
+    bool is_inline() const noexcept {
+        return data_ == get_inline_data();
+    }
+
+    T* data() noexcept {
+        return data_;
+    }
+
+    const T* data() const noexcept {
+        return data_;
+    }
+
+    T& operator[](size_t index) noexcept {
+        assert(index < size_);
+        return data_[index];
+    }
+
+    const T& operator[](size_t index) const noexcept {
+        assert(index < size_);
+        return data_[index];
+    }
+
+    T& front() noexcept {
+        return (*this)[0];
+    }
+
+    const T& front() const noexcept {
+        return (*this)[0];
+    }
+
+    T& back() noexcept {
+        return (*this)[size_ - 1];
+    }
+
+    const T& back() const noexcept {
+        return (*this)[size_ - 1];
+    }
+
+    iterator begin() noexcept {
+        return data_;
+    }
+
+    const_iterator begin() const noexcept {
+        return data_;
+    }
+
+    iterator end() noexcept {
+        return data_ + size_;
+    }
+
+    const_iterator end() const noexcept {
+        return data_ + size_;
+    }
+
+    void reserve(size_t capacity) noexcept {
+        if (capacity > capacity_) {
+            relocate(allocate(capacity), capacity);
+        }
+    }
+
+    // New elements are value-initialized
+    void resize(size_t size) noexcept {
+        reserve(size);
+        while (size_ < size) {
+            new (data_ + size_++) T();
+        }
+        while (size_ > size) {
+            pop_back();
+        }
+    }
+
+    // Destroys elements, but keeps storage
+    void clear() noexcept {
+        while (size_ != 0) {
+            pop_back();
+        }
+    }
+
+    template<typename... Args>
+    T& emplace_back(Args&&... args) noexcept {
+        if (size_ == capacity_) {
+            // New element is constructed before relocation, as arguments may refer to existing elements
+            T* new_data = allocate(capacity_ * 2);
+            new (new_data + size_) T(std::forward<Args>(args)...);
+            relocate(new_data, capacity_ * 2);
+        } else {
+            new (data_ + size_) T(std::forward<Args>(args)...);
+        }
+        return data_[size_++];
+    }
+
+    void push_back(const T& value) noexcept {
+        emplace_back(value);
+    }
+
+    void push_back(T&& value) noexcept {
+        emplace_back(std::move(value));
+    }
+
+    void pop_back() noexcept {
+        assert(size_ != 0);
+        data_[--size_].~T();
+    }
+
+    bool operator==(const SmallVector& other) const noexcept {
+        if (size_ != other.size_) {
+            return false;
+        }
+        for (size_t i = 0; i < size_; ++i) {
+            if (!(data_[i] == other.data_[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const SmallVector& other) const noexcept {
+        return !(*this == other);
+    }
+
+private:
+    T* get_inline_data() noexcept {
+        return std::launder(static_cast<T*>(static_cast<void*>(storage_)));
+    }
+
+    const T* get_inline_data() const noexcept {
+        return std::launder(static_cast<const T*>(static_cast<const void*>(storage_)));
+    }
+
+    static T* allocate(size_t capacity) noexcept {
+        return static_cast<T*>(::operator new(capacity * sizeof(T)));
+    }
+
+    void deallocate() noexcept {
+        if (!is_inline()) {
+            ::operator delete(data_);
+            data_ = get_inline_data();
+            capacity_ = N;
+        }
+    }
+
+    // Moves elements to new heap storage
+    void relocate(T* new_data, size_t new_capacity) noexcept {
+        for (size_t i = 0; i < size_; ++i) {
+            new (new_data + i) T(std::move(data_[i]));
+            data_[i].~T();
+        }
+        deallocate();
+        data_ = new_data;
+        capacity_ = new_capacity;
+    }
+
+    void copy_from(const SmallVector& other) noexcept {
+        reserve(other.size_);
+        for (size_t i = 0; i < other.size_; ++i) {
+            new (data_ + size_++) T(other.data_[i]);
+        }
+    }
+
+    // Heap storage of other is taken over, inline elements are moved one by one. Expects this to be empty and inline
+    void move_from(SmallVector& other) noexcept {
+        if (other.is_inline()) {
+            for (size_t i = 0; i < other.size_; ++i) {
+                new (data_ + size_++) T(std::move(other.data_[i]));
+            }
+            other.clear();
+        } else {
+            data_ = std::exchange(other.data_, other.get_inline_data());
+            size_ = std::exchange(other.size_, 0);
+            capacity_ = std::exchange(other.capacity_, N);
+        }
+    }
+
+    alignas(T) unsigned char storage_[sizeof(T) * N];
+    T* data_;
+    size_t size_;
+    size_t capacity_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_SMALL_VECTOR_H
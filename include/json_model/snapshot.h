@@ -0,0 +1,499 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_SNAPSHOT_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_SNAPSHOT_H
+
+#include "error.h"
+#include "stream.h"
+#include "traits.h"
+#include "types.h"
+#include "value.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <type_traits>
+#include <typeindex>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace json_model {
+
+// Snapshot is a keyless binary format, which can be read in place (e.g. from mmapped file) without deserialization,
+// see snapshot_view.h. Fields are stored by their position in PROVIDE_DETAILS, and snapshot header contains
+// fingerprint of the model schema, so that snapshot is never read as a model with different fields.
+//
+// Snapshot consists of 8-byte words in host byte order:
+//  - header: magic, version, schema fingerprint
+//  - payloads of records, strings and containers, each starting at 8-byte aligned offset
+//  - footer: offset of root record
+// Values are referred to by 8-byte slots. Slot holds bool, integer or bits of double as is, and offset of payload
+// from the beginning of snapshot for other types:
+//  - string: length, characters, null terminator, padding
+//  - vector: size, slots of elements
+//  - map: size, pairs of slots of key and value, sorted by key
+//  - variant: index of alternative, slot of value
+//  - model (record): presence bitmap of fields, slots of fields (zero for absent optional fields)
+// Payloads are written before payloads which refer to them, so snapshot is written in one pass. Each payload is
+// referred to by exactly one slot
+
+inline constexpr uint64_t SNAPSHOT_MAGIC = 0x50414e534d4a; // "JMSNAP" in little-endian
+inline constexpr uint64_t SNAPSHOT_VERSION = 1;
+inline constexpr size_t SNAPSHOT_HEADER_SIZE = 24;
+inline constexpr size_t SNAPSHOT_FOOTER_SIZE = 8;
+
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(OutputStream& stream) noexcept: stream_(stream), position_(0) {}
+
+    void write_header(uint64_t fingerprint) noexcept {
+        write_word(SNAPSHOT_MAGIC);
+        write_word(SNAPSHOT_VERSION);
+        write_word(fingerprint);
+    }
+
+    void write_footer(uint64_t root_offset) noexcept {
+        write_word(root_offset);
+    }
+
+    uint64_t write_string(const char* str, size_t length) noexcept {
+        static constexpr char zeros[8] = {};
+        uint64_t offset = position_;
+        write_word(length);
+        stream_.write(str, length);
+        // At least one zero byte terminates string
+        size_t padding = 8 - length % 8;
+        stream_.write(zeros, padding);
+        position_ += length + padding;
+        return offset;
+    }
+
+    // Slots of records and containers are collected on a stack, since payloads of their values are written first
+    size_t start_slots() const noexcept {
+        return slots_.size();
+    }
+
+    void add_slot(uint64_t slot, bool present = true) noexcept {
+        slots_.push_back(slot);
+        presence_.push_back(present);
+    }
+
+    // Writes size of container and its slots collected since `begin`
+    uint64_t end_container(size_t begin, size_t size) noexcept {
+        uint64_t offset = position_;
+        write_word(size);
+        write_slots(begin);
+        return offset;
+    }
+
+    uint64_t end_record(size_t begin) noexcept {
+        uint64_t offset = position_;
+        size_t fields = slots_.size() - begin;
+        for (size_t word = 0; word < (fields + 63) / 64; ++word) {
+            uint64_t bits = 0;
+            for (size_t i = word * 64; i < std::min(fields, word * 64 + 64); ++i) {
+                bits |= static_cast<uint64_t>(presence_[begin + i]) << (i % 64);
+            }
+            write_word(bits);
+        }
+        write_slots(begin);
+        return offset;
+    }
+
+    uint64_t write_variant(size_t index, uint64_t slot) noexcept {
+        uint64_t offset = position_;
+        write_word(index);
+        write_word(slot);
+        return offset;
+    }
+
+private:
+    void write_word(uint64_t word) noexcept {
+        stream_.write(reinterpret_cast<const char*>(&word), sizeof(word));
+        position_ += sizeof(word);
+    }
+
+    void write_slots(size_t begin) noexcept {
+        for (size_t i = begin; i < slots_.size(); ++i) {
+            write_word(slots_[i]);
+        }
+        slots_.resize(begin);
+        presence_.resize(begin);
+    }
+
+    OutputStream& stream_;
+    uint64_t position_;
+    std::vector<uint64_t> slots_;
+    std::vector<bool> presence_;
+};
+
+template<typename T>
+typename std::enable_if_t<is_primitive_v<T>, uint64_t>
+to_snapshot(SnapshotWriter& writer, const T& value) noexcept {
+    if constexpr (std::is_same_v<T, double>) {
+        uint64_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        return writer.write_string(value.data(), value.size());
+    } else if constexpr (std::is_same_v<T, Bytes>) {
+        return writer.write_string(reinterpret_cast<const char*>(value.data()), value.size());
+    } else if constexpr (std::is_same_v<T, RawNumber> || std::is_same_v<T, RawJson>) {
+        return writer.write_string(value.get_text().data(), value.get_text().size());
+    } else if constexpr (std::is_same_v<T, Value>) {
+        // Dynamic value is stored as its compact JSON
+        std::string json;
+        StringSink sink(json);
+        OutputStream stream(sink);
+        json_writer_t json_writer(stream);
+        value.get_value().Accept(json_writer);
+        json_writer.Flush();
+        return writer.write_string(json.data(), json.size());
+    } else if constexpr (std::is_same_v<T, std::nullptr_t>) {
+        return 0;
+    } else if constexpr (std::is_signed_v<T>) {
+        return static_cast<uint64_t>(static_cast<int64_t>(value));
+    } else {
+        return static_cast<uint64_t>(value);
+    }
+}
+
+template<typename T>
+typename std::enable_if_t<is_pointer_v<T>, uint64_t>
+to_snapshot(SnapshotWriter& writer, const T& value) noexcept {
+    assert(value);
+    return value->to_snapshot_internal(writer);
+}
+
+template<typename T>
+typename std::enable_if_t<is_map_v<T>, uint64_t>
+to_snapshot(SnapshotWriter& writer, const T& value) noexcept;
+
+template<typename T>
+typename std::enable_if_t<is_variant_v<T>, uint64_t>
+to_snapshot(SnapshotWriter& writer, const T& value) noexcept;
+
+template<typename T>
+typename std::enable_if_t<is_vector_v<T>, uint64_t>
+to_snapshot(SnapshotWriter& writer, const T& value) noexcept {
+    size_t begin = writer.start_slots();
+    for (size_t i = 0; i < value.size(); ++i) {
+        writer.add_slot(to_snapshot(writer, value[i]));
+    }
+    return writer.end_container(begin, value.size());
+}
+
+template<typename T>
+typename std::enable_if_t<is_map_v<T>, uint64_t>
+to_snapshot(SnapshotWriter& writer, const T& value) noexcept {
+    std::vector<const typename T::value_type*> items;
+    items.reserve(value.size());
+    for (const auto& item : value) {
+        items.push_back(&item);
+    }
+    if constexpr (!std::is_same_v<T, std::map<typename T::key_type, typename T::mapped_type>>) {
+        std::sort(items.begin(), items.end(), [](const auto* lhs, const auto* rhs) noexcept {
+            return lhs->first < rhs->first;
+        });
+    }
+    size_t begin = writer.start_slots();
+    for (const auto* item : items) {
+        writer.add_slot(writer.write_string(item->first.data(), item->first.size()));
+        writer.add_slot(to_snapshot(writer, item->second));
+    }
+    return writer.end_container(begin, value.size());
+}
+
+template<typename T>
+typename std::enable_if_t<is_variant_v<T>, uint64_t>
+to_snapshot(SnapshotWriter& writer, const T& value) noexcept {
+    assert(!value.valueless_by_exception());
+    uint64_t slot = std::visit(
+        [&writer](auto&& arg) noexcept {
+            return to_snapshot(writer, arg);
+        }, value
+    );
+    return writer.write_variant(value.index(), slot);
+}
+
+inline uint64_t load_snapshot_word(const char* data) noexcept {
+    uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+class SnapshotChecker;
+
+// Checks value of type T, which is referred to by slot at `slot_offset`. Absent optional values aren't checked
+using SnapshotSlotCheck = void (*)(SnapshotChecker& checker, uint64_t slot_offset, bool present);
+
+template<typename T>
+void check_snapshot_slot(SnapshotChecker& checker, uint64_t slot_offset, bool present);
+
+// Schema of a model is its field names with signatures of their types. Nested models are expanded in place, and
+// recursive reference to a model which is being expanded is written as distance to it
+template<typename T>
+std::string snapshot_signature(std::vector<std::type_index>& models) noexcept;
+
+class SchemaCollector {
+public:
+    explicit SchemaCollector(std::vector<std::type_index>& models) noexcept: models_(models) {}
+
+    template<typename T>
+    void add_field(const char* name) noexcept {
+        names_.emplace_back(name);
+        signatures_.push_back(snapshot_signature<T>(models_));
+        signature_ += names_.back() + ":" + signatures_.back() + ";";
+        checks_.push_back(&check_snapshot_slot<T>);
+    }
+
+    const std::vector<std::string>& get_names() const noexcept {
+        return names_;
+    }
+
+    const std::vector<std::string>& get_signatures() const noexcept {
+        return signatures_;
+    }
+
+    const std::string& get_signature() const noexcept {
+        return signature_;
+    }
+
+    const std::vector<SnapshotSlotCheck>& get_checks() const noexcept {
+        return checks_;
+    }
+
+private:
+    std::vector<std::type_index>& models_;
+    std::vector<std::string> names_;
+    std::vector<std::string> signatures_;
+    std::string signature_;
+    std::vector<SnapshotSlotCheck> checks_;
+};
+
+template<typename M>
+std::string model_snapshot_signature(std::vector<std::type_index>& models) noexcept {
+    auto iter = std::find(models.begin(), models.end(), std::type_index(typeid(M)));
+    if (iter != models.end()) {
+        return "@" + std::to_string(models.end() - iter);
+    }
+    models.emplace_back(typeid(M));
+    const M model;
+    SchemaCollector collector(models);
+    model.snapshot_schema_fields_internal(collector);
+    models.pop_back();
+    return "(" + collector.get_signature() + ")";
+}
+
+template<typename... Args>
+std::string variant_snapshot_signature(std::vector<std::type_index>& models) noexcept {
+    std::string result = "<";
+    ((result += snapshot_signature<Args>(models) + ","), ...);
+    result.back() = '>';
+    return result;
+}
+
+template<typename T>
+struct variant_snapshot_signature_helper;
+
+template<typename... Args>
+struct variant_snapshot_signature_helper<std::variant<Args...>> {
+    static std::string get(std::vector<std::type_index>& models) noexcept {
+        return variant_snapshot_signature<Args...>(models);
+    }
+};
+
+template<typename T>
+std::string snapshot_signature(std::vector<std::type_index>& models) noexcept {
+    if constexpr (is_enum_v<T>) {
+        // Enums are stored as their index, so names are part of signature
+        return "e(" + EnumTable<T>::describe() + ")";
+    } else if constexpr (std::is_same_v<T, bool>) {
+        return "b";
+    } else if constexpr (std::is_same_v<T, double>) {
+        return "d";
+    } else if constexpr (std::is_same_v<T, int>) {
+        return "i";
+    } else if constexpr (std::is_same_v<T, int64_t>) {
+        return "l";
+    } else if constexpr (std::is_same_v<T, unsigned>) {
+        return "u";
+    } else if constexpr (std::is_same_v<T, uint64_t>) {
+        return "q";
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        return "s";
+    } else if constexpr (std::is_same_v<T, Bytes>) {
+        return "x";
+    } else if constexpr (std::is_same_v<T, RawNumber>) {
+        return "r";
+    } else if constexpr (std::is_same_v<T, RawJson>) {
+        return "j";
+    } else if constexpr (std::is_same_v<T, Value>) {
+        return "v";
+    } else if constexpr (std::is_same_v<T, std::nullptr_t>) {
+        return "n";
+    } else if constexpr (is_pointer_v<T>) {
+        return model_snapshot_signature<typename T::element_type>(models);
+    } else if constexpr (is_vector_v<T>) {
+        return "[" + snapshot_signature<typename T::value_type>(models) + "]";
+    } else if constexpr (is_map_v<T>) {
+        return "{" + snapshot_signature<typename T::mapped_type>(models) + "}";
+    } else if constexpr (is_variant_v<T>) {
+        return variant_snapshot_signature_helper<T>::get(models);
+    } else if constexpr (is_optional_v<T>) {
+        return "?" + snapshot_signature<typename T::value_type>(models);
+    }
+}
+
+struct SnapshotSchema {
+    std::vector<std::string> names;
+    std::vector<std::string> signatures;
+    uint64_t fingerprint;
+    std::vector<SnapshotSlotCheck> checks;
+};
+
+template<typename M>
+SnapshotSchema build_snapshot_schema() noexcept {
+    std::vector<std::type_index> models{typeid(M)};
+    const M model;
+    SchemaCollector collector(models);
+    model.snapshot_schema_fields_internal(collector);
+
+    // FNV-1a
+    uint64_t fingerprint = 0xcbf29ce484222325;
+    for (char c : collector.get_signature()) {
+        fingerprint = (fingerprint ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+    }
+    return SnapshotSchema{collector.get_names(), collector.get_signatures(), fingerprint, collector.get_checks()};
+}
+
+// Checks that every offset and length, which views read from snapshot, lies between its header and footer.
+// DecodeError is thrown otherwise. As payloads are never shared, a valid snapshot has at least as many words as
+// slots, so the number of checked slots is bounded by size and crafted snapshots with shared payloads can't make
+// checking slow
+class SnapshotChecker {
+public:
+    SnapshotChecker(const char* data, size_t size) noexcept
+        : data_(data), end_(size - SNAPSHOT_FOOTER_SIZE), slots_left_(size / 8) {}
+
+    uint64_t load(uint64_t offset) const noexcept {
+        return load_snapshot_word(data_ + offset);
+    }
+
+    // Returns offset of payload which starts with `words` words
+    uint64_t payload(uint64_t slot_offset, uint64_t words) {
+        uint64_t offset = load(slot_offset);
+        if (offset < SNAPSHOT_HEADER_SIZE || offset > end_ || offset % 8 != 0 || words > (end_ - offset) / 8) {
+            fail(slot_offset, "Offset is out of bounds");
+        }
+        return offset;
+    }
+
+    void check_string(uint64_t slot_offset) {
+        uint64_t offset = payload(slot_offset, 1);
+        // Characters are followed by null terminator
+        if (load(offset) >= end_ - offset - 8) {
+            fail(offset, "String is out of bounds");
+        }
+    }
+
+    // Returns offset of payload of container with `size` items of `words` words each, size is the first word
+    uint64_t container(uint64_t slot_offset, uint64_t words, uint64_t& size) {
+        uint64_t offset = payload(slot_offset, 1);
+        size = load(offset);
+        if (size > ((end_ - offset) / 8 - 1) / words) {
+            fail(offset, "Container is out of bounds");
+        }
+        take_slots(offset, size * words);
+        return offset;
+    }
+
+    template<typename M>
+    void check_record(uint64_t slot_offset) {
+        const auto& checks = M::snapshot_schema_internal().checks;
+        uint64_t bitmap_words = (checks.size() + 63) / 64;
+        uint64_t offset = payload(slot_offset, bitmap_words + checks.size());
+        take_slots(offset, checks.size());
+        for (size_t i = 0; i < checks.size(); ++i) {
+            bool present = (load(offset + i / 64 * 8) >> (i % 64)) & 1;
+            checks[i](*this, offset + (bitmap_words + i) * 8, present);
+        }
+    }
+
+    template<typename T>
+    void check_variant(uint64_t slot_offset) {
+        check_variant_alternative<T>(slot_offset, std::make_index_sequence<std::variant_size_v<T>>());
+    }
+
+    [[noreturn]] static void fail(uint64_t offset, const char* reason) {
+        throw DecodeError("snapshot", offset, reason);
+    }
+
+private:
+    template<typename T, size_t... I>
+    void check_variant_alternative(uint64_t slot_offset, std::index_sequence<I...>) {
+        static constexpr SnapshotSlotCheck checks[] = {&check_snapshot_slot<std::variant_alternative_t<I, T>>...};
+        uint64_t offset = payload(slot_offset, 2);
+        uint64_t index = load(offset);
+        if (index >= std::variant_size_v<T>) {
+            fail(offset, "Invalid variant index");
+        }
+        take_slots(offset, 1);
+        checks[index](*this, offset + 8, true);
+    }
+
+    void take_slots(uint64_t offset, uint64_t count) {
+        if (count > slots_left_) {
+            fail(offset, "Payload is referred to more than once");
+        }
+        slots_left_ -= count;
+    }
+
+    const char* data_;
+    uint64_t end_;
+    uint64_t slots_left_;
+};
+
+template<typename T>
+void check_snapshot_slot(SnapshotChecker& checker, uint64_t slot_offset, bool present) {
+    if constexpr (is_optional_v<T>) {
+        if (present) {
+            check_snapshot_slot<typename T::value_type>(checker, slot_offset, true);
+        }
+    } else if constexpr (is_enum_v<T>) {
+        if (checker.load(slot_offset) >= EnumTable<T>::SIZE) {
+            SnapshotChecker::fail(slot_offset, "Invalid enum value");
+        }
+    } else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, Bytes> || std::is_same_v<T, RawNumber> ||
+                         std::is_same_v<T, RawJson> || std::is_same_v<T, Value>) {
+        checker.check_string(slot_offset);
+    } else if constexpr (is_primitive_v<T>) {
+        // Value is stored in slot
+    } else if constexpr (is_pointer_v<T>) {
+        checker.check_record<typename T::element_type>(slot_offset);
+    } else if constexpr (is_vector_v<T>) {
+        uint64_t size = 0;
+        uint64_t offset = checker.container(slot_offset, 1, size);
+        for (uint64_t i = 0; i < size; ++i) {
+            check_snapshot_slot<typename T::value_type>(checker, offset + 8 + i * 8, true);
+        }
+    } else if constexpr (is_map_v<T>) {
+        uint64_t size = 0;
+        uint64_t offset = checker.container(slot_offset, 2, size);
+        for (uint64_t i = 0; i < size; ++i) {
+            checker.check_string(offset + 8 + i * 16);
+            check_snapshot_slot<typename T::mapped_type>(checker, offset + 16 + i * 16, true);
+        }
+    } else if constexpr (is_variant_v<T>) {
+        checker.check_variant<T>(slot_offset);
+    }
+}
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_SNAPSHOT_H
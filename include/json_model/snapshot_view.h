@@ -0,0 +1,370 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_SNAPSHOT_VIEW_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_SNAPSHOT_VIEW_H
+
+#include "model.h"
+#include "error.h"
+#include "snapshot.h"
+#include "traits.h"
+
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+
+#if __has_include(<sys/mman.h>) && __has_include(<unistd.h>)
+#define JSON_MODEL_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace json_model {
+
+// Views read values of snapshot in place. Views are cheap to copy and are valid while snapshot data is alive.
+// open_snapshot() checks all offsets and lengths once, so views don't check them again
+
+template<typename T>
+class VectorView;
+
+template<typename T>
+class MapView;
+
+template<typename T>
+class VariantView;
+
+template<typename M>
+class RecordView;
+
+// Type of view of a field or container element of type T
+template<typename T, typename = void>
+struct snapshot_view {
+    using type = T;
+};
+
+template<>
+struct snapshot_view<std::string> {
+    using type = std::string_view;
+};
+
+// Bytes are stored raw, not in base64
+template<>
+struct snapshot_view<Bytes> {
+    using type = std::string_view;
+};
+
+// Text of number
+template<>
+struct snapshot_view<RawNumber> {
+    using type = std::string_view;
+};
+
+// Text of value
+template<>
+struct snapshot_view<RawJson> {
+    using type = std::string_view;
+};
+
+// Compact JSON of value
+template<>
+struct snapshot_view<Value> {
+    using type = std::string_view;
+};
+
+template<typename T>
+struct snapshot_view<T, std::enable_if_t<is_vector_v<T>>> {
+    using type = VectorView<typename T::value_type>;
+};
+
+template<typename T>
+struct snapshot_view<T, std::enable_if_t<is_map_v<T>>> {
+    using type = MapView<typename T::mapped_type>;
+};
+
+template<typename T>
+struct snapshot_view<T, std::enable_if_t<is_variant_v<T>>> {
+    using type = VariantView<T>;
+};
+
+template<typename T>
+struct snapshot_view<T, std::enable_if_t<is_pointer_v<T>>> {
+    using type = RecordView<typename T::element_type>;
+};
+
+template<typename T>
+struct snapshot_view<T, std::enable_if_t<is_optional_v<T>>> {
+    using type = std::optional<typename snapshot_view<typename T::value_type>::type>;
+};
+
+template<typename T>
+using snapshot_view_t = typename snapshot_view<T>::type;
+
+template<typename T>
+snapshot_view_t<T> make_snapshot_view(const char* data, uint64_t slot) noexcept;
+
+template<typename T>
+class VectorView {
+public:
+    VectorView(const char* data, uint64_t offset) noexcept: data_(data), payload_(data + offset) {}
+
+    size_t size() const noexcept {
+        return load_snapshot_word(payload_);
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    snapshot_view_t<T> operator[](size_t index) const noexcept {
+        assert(index < size());
+        return make_snapshot_view<T>(data_, load_snapshot_word(payload_ + 8 + index * 8));
+    }
+
+private:
+    const char* data_;
+    const char* payload_;
+};
+
+template<typename T>
+class MapView {
+public:
+    MapView(const char* data, uint64_t offset) noexcept: data_(data), payload_(data + offset) {}
+
+    size_t size() const noexcept {
+        return load_snapshot_word(payload_);
+    }
+
+    bool empty() const noexcept {
+        return size() == 0;
+    }
+
+    // Items are sorted by key
+    std::string_view key(size_t index) const noexcept {
+        assert(index < size());
+        return make_snapshot_view<std::string>(data_, load_snapshot_word(payload_ + 8 + index * 16));
+    }
+
+    snapshot_view_t<T> value(size_t index) const noexcept {
+        assert(index < size());
+        return make_snapshot_view<T>(data_, load_snapshot_word(payload_ + 16 + index * 16));
+    }
+
+    // Returns index of item with given key, or size() if there is no such item
+    size_t find(std::string_view key) const noexcept {
+        size_t left = 0;
+        size_t right = size();
+        while (left < right) {
+            size_t middle = left + (right - left) / 2;
+            if (this->key(middle) < key) {
+                left = middle + 1;
+            } else {
+                right = middle;
+            }
+        }
+        return (left != size() && this->key(left) == key) ? left : size();
+    }
+
+    std::optional<snapshot_view_t<T>> get(std::string_view key) const noexcept {
+        size_t index = find(key);
+        if (index == size()) {
+            return std::nullopt;
+        }
+        return value(index);
+    }
+
+private:
+    const char* data_;
+    const char* payload_;
+};
+
+template<typename T>
+class VariantView {
+public:
+    VariantView(const char* data, uint64_t offset) noexcept: data_(data), payload_(data + offset) {}
+
+    size_t index() const noexcept {
+        return load_snapshot_word(payload_);
+    }
+
+    template<size_t I>
+    snapshot_view_t<std::variant_alternative_t<I, T>> get() const noexcept {
+        assert(index() == I);
+        return make_snapshot_view<std::variant_alternative_t<I, T>>(data_, load_snapshot_word(payload_ + 8));
+    }
+
+private:
+    const char* data_;
+    const char* payload_;
+};
+
+template<typename M>
+class RecordView {
+public:
+    RecordView(const char* data, uint64_t offset) noexcept
+        : data_(data), payload_(data + offset), schema_(&M::snapshot_schema_internal()),
+          bitmap_words_((schema_->names.size() + 63) / 64) {}
+
+    // Index of field by its JSON name. Fields can be accessed by name too, but access by index is faster
+    static size_t field_index(std::string_view name) noexcept {
+        const auto& names = M::snapshot_schema_internal().names;
+        for (size_t i = 0; i < names.size(); ++i) {
+            if (names[i] == name) {
+                return i;
+            }
+        }
+        assert(false && "No field with such name");
+        return names.size();
+    }
+
+    bool has(size_t index) const noexcept {
+        assert(index < schema_->names.size());
+        return (load_snapshot_word(payload_ + index / 64 * 8) >> (index % 64)) & 1;
+    }
+
+    // T is the declared type of field, absent optional fields are returned as std::nullopt
+    template<typename T>
+    snapshot_view_t<T> get(size_t index) const noexcept {
+        assert(index < schema_->names.size());
+        assert(schema_->signatures[index] == get_signature<T>());
+        uint64_t slot = load_snapshot_word(payload_ + (bitmap_words_ + index) * 8);
+        if constexpr (is_optional_v<T>) {
+            if (!has(index)) {
+                return std::nullopt;
+            }
+            return make_snapshot_view<typename T::value_type>(data_, slot);
+        } else {
+            return make_snapshot_view<T>(data_, slot);
+        }
+    }
+
+    template<typename T>
+    snapshot_view_t<T> get(std::string_view name) const noexcept {
+        return get<T>(field_index(name));
+    }
+
+private:
+    template<typename T>
+    static std::string get_signature() noexcept {
+        std::vector<std::type_index> models{typeid(M)};
+        return snapshot_signature<T>(models);
+    }
+
+    const char* data_;
+    const char* payload_;
+    const SnapshotSchema* schema_;
+    size_t bitmap_words_;
+};
+
+template<typename T>
+snapshot_view_t<T> make_snapshot_view(const char* data, uint64_t slot) noexcept {
+    if constexpr (std::is_same_v<T, bool>) {
+        return slot != 0;
+    } else if constexpr (std::is_same_v<T, double>) {
+        double value;
+        std::memcpy(&value, &slot, sizeof(value));
+        return value;
+    } else if constexpr (std::is_same_v<T, std::string> || std::is_same_v<T, Bytes> || std::is_same_v<T, RawNumber> ||
+                         std::is_same_v<T, RawJson> || std::is_same_v<T, Value>) {
+        return std::string_view(data + slot + 8, load_snapshot_word(data + slot));
+    } else if constexpr (std::is_same_v<T, std::nullptr_t>) {
+        return nullptr;
+    } else if constexpr (is_primitive_v<T>) {
+        return static_cast<T>(slot);
+    } else {
+        return snapshot_view_t<T>(data, slot);
+    }
+}
+
+// Validates snapshot and returns view of the root model. Throws DecodeError if data is not a snapshot of M, or if it
+// is truncated or corrupted so that views would read outside of it. Every payload is checked, so this takes time
+// proportional to size of snapshot
+template<typename M>
+RecordView<M> open_snapshot(const char* data, size_t size) {
+    if (size < SNAPSHOT_HEADER_SIZE + SNAPSHOT_FOOTER_SIZE) {
+        throw DecodeError("snapshot", 0, "Snapshot is too small");
+    }
+    if (load_snapshot_word(data) != SNAPSHOT_MAGIC) {
+        throw DecodeError("snapshot", 0, "Invalid magic");
+    }
+    if (load_snapshot_word(data + 8) != SNAPSHOT_VERSION) {
+        throw DecodeError("snapshot", 8, "Unsupported version or byte order");
+    }
+    if (load_snapshot_word(data + 16) != M::snapshot_schema_internal().fingerprint) {
+        throw DecodeError("snapshot", 16, "Schema fingerprint mismatch");
+    }
+    if (size % 8 != 0) {
+        throw DecodeError("snapshot", size, "Snapshot is truncated");
+    }
+    SnapshotChecker checker(data, size);
+    checker.check_record<M>(size - SNAPSHOT_FOOTER_SIZE);
+    return RecordView<M>(data, load_snapshot_word(data + size - SNAPSHOT_FOOTER_SIZE));
+}
+
+#ifdef JSON_MODEL_MMAP
+// Read-only memory mapping of a file
+class MappedFile {
+public:
+    MappedFile() noexcept: data_(nullptr), size_(0) {}
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() noexcept {
+        close();
+    }
+
+    // Returns false if file can't be mapped
+    bool open(const char* path) noexcept {
+        close();
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat file_stat {};
+        if (::fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+            ::close(fd);
+            return false;
+        }
+        size_t size = static_cast<size_t>(file_stat.st_size);
+        void* data = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (data == MAP_FAILED) {
+            return false;
+        }
+        data_ = static_cast<const char*>(data);
+        size_ = size;
+        return true;
+    }
+
+    void close() noexcept {
+        if (data_ != nullptr) {
+            ::munmap(const_cast<char*>(data_), size_);
+            data_ = nullptr;
+            size_ = 0;
+        }
+    }
+
+    const char* data() const noexcept {
+        return data_;
+    }
+
+    size_t size() const noexcept {
+        return size_;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+};
+#endif
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_SNAPSHOT_VIEW_H
@@ -0,0 +1,195 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_STREAM_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_STREAM_H
+
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#if __has_include(<unistd.h>)
+#include <unistd.h>
+#endif
+
+namespace json_model {
+
+// Destination of serialized bytes. Writes are always done in chunks, so implementations don't need to do buffering
+class Sink {
+public:
+    virtual ~Sink() noexcept = default;
+
+    // Returns false if data can't be written. No more writes are done after failure
+    virtual bool write(const char* data, size_t size) noexcept = 0;
+
+    virtual bool flush() noexcept {
+        return true;
+    }
+};
+
+class StringSink : public Sink {
+public:
+    explicit StringSink(std::string& str) noexcept: str_(str) {}
+    ~StringSink() noexcept override = default;
+
+    bool write(const char* data, size_t size) noexcept override {
+        str_.append(data, size);
+        return true;
+    }
+
+private:
+    std::string& str_;
+};
+
+class OStreamSink : public Sink {
+public:
+    explicit OStreamSink(std::ostream& os) noexcept: os_(os) {}
+    ~OStreamSink() noexcept override = default;
+
+    bool write(const char* data, size_t size) noexcept override {
+        os_.write(data, static_cast<std::streamsize>(size));
+        return os_.good();
+    }
+
+    bool flush() noexcept override {
+        os_.flush();
+        return os_.good();
+    }
+
+private:
+    std::ostream& os_;
+};
+
+class FileSink : public Sink {
+public:
+    explicit FileSink(std::FILE* file) noexcept: file_(file) {}
+    ~FileSink() noexcept override = default;
+
+    bool write(const char* data, size_t size) noexcept override {
+        return std::fwrite(data, 1, size, file_) == size;
+    }
+
+    bool flush() noexcept override {
+        return std::fflush(file_) == 0;
+    }
+
+private:
+    std::FILE* file_;
+};
+
+#if __has_include(<unistd.h>)
+class FdSink : public Sink {
+public:
+    explicit FdSink(int fd) noexcept: fd_(fd) {}
+    ~FdSink() noexcept override = default;
+
+    bool write(const char* data, size_t size) noexcept override {
+        while (size != 0) {
+            ssize_t written = ::write(fd_, data, size);
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+private:
+    int fd_;
+};
+#endif
+
+// Fixed-size buffer in front of the sink, implements rapidjson output stream concept
+class OutputStream {
+public:
+    using Ch = char;
+
+    explicit OutputStream(Sink& sink) noexcept: sink_(sink), cur_(buffer_), failed_(false), defer_flush_(false) {}
+    OutputStream(const OutputStream&) = delete;
+    OutputStream& operator=(const OutputStream&) = delete;
+    ~OutputStream() noexcept = default;
+
+    void Put(char c) noexcept {
+        if (cur_ == buffer_ + BUFFER_SIZE) {
+            flush_buffer();
+        }
+        *cur_++ = c;
+    }
+
+    void Flush() noexcept {
+        if (defer_flush_) return;
+        flush_buffer();
+        if (!failed_ && !sink_.flush()) {
+            failed_ = true;
+        }
+    }
+
+    // Not a part of rapidjson concept, used for bulk writes
+    void write(const char* data, size_t size) noexcept {
+        // Empty payloads may come with null data, which memcpy doesn't accept
+        if (size == 0) return;
+        size_t available = static_cast<size_t>(buffer_ + BUFFER_SIZE - cur_);
+        if (size <= available) {
+            std::memcpy(cur_, data, size);
+            cur_ += size;
+            return;
+        }
+        flush_buffer();
+        if (size < BUFFER_SIZE) {
+            std::memcpy(cur_, data, size);
+            cur_ += size;
+        } else if (!failed_ && !sink_.write(data, size)) {
+            failed_ = true;
+        }
+    }
+
+    // Returns pointer to at least `size` bytes of buffer. Bytes actually written must be committed with advance()
+    char* get_buffer(size_t size) noexcept {
+        assert(size <= BUFFER_SIZE);
+        if (static_cast<size_t>(buffer_ + BUFFER_SIZE - cur_) < size) {
+            flush_buffer();
+        }
+        return cur_;
+    }
+
+    void advance(char* end) noexcept {
+        assert(cur_ <= end && end <= buffer_ + BUFFER_SIZE);
+        cur_ = end;
+    }
+
+    // rapidjson::Writer flushes stream after every top-level value. Writers of several values defer these flushes
+    // until the end
+    void defer_flush(bool defer) noexcept {
+        defer_flush_ = defer;
+    }
+
+    bool is_failed() const noexcept {
+        return failed_;
+    }
+
+    static constexpr size_t BUFFER_SIZE = 8192;
+
+private:
+    void flush_buffer() noexcept {
+        if (!failed_ && cur_ != buffer_ && !sink_.write(buffer_, static_cast<size_t>(cur_ - buffer_))) {
+            failed_ = true;
+        }
+        cur_ = buffer_;
+    }
+
+    Sink& sink_;
+    char buffer_[BUFFER_SIZE];
+    char* cur_;
+    bool failed_;
+    bool defer_flush_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_STREAM_H
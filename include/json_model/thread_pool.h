@@ -0,0 +1,128 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_THREAD_POOL_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace json_model {
+
+// Pool of worker threads for parallel serialization. Jobs are split into tasks, which are claimed dynamically one by
+// one by workers and by the thread which submitted the job, so faster threads take more tasks
+class ThreadPool {
+public:
+    // Thread that calls run() participates too, so `threads` is number of additional threads
+    explicit ThreadPool(size_t threads) noexcept {
+        workers_.reserve(threads);
+        for (size_t i = 0; i < threads; ++i) {
+            workers_.emplace_back([this]() noexcept { work(); });
+        }
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    ~ThreadPool() noexcept {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = true;
+        }
+        job_cv_.notify_all();
+        for (auto& worker : workers_) {
+            worker.join();
+        }
+    }
+
+    // Number of threads which execute job, including caller of run()
+    size_t get_concurrency() const noexcept {
+        return workers_.size() + 1;
+    }
+
+    // Calls task(i) for every i in [0, count) and waits until all calls are finished. Jobs submitted from different
+    // threads are executed one after another
+    template<typename F>
+    void run(size_t count, F& task) noexcept {
+        std::lock_guard<std::mutex> run_lock(run_mutex_);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            invoke_ = [](void* f, size_t i) noexcept {
+                (*static_cast<F*>(f))(i);
+            };
+            task_ = &task;
+            count_ = count;
+            next_.store(0);
+            finished_.store(0);
+            job_open_ = true;
+            generation_++;
+        }
+        job_cv_.notify_all();
+
+        execute_tasks();
+
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_cv_.wait(lock, [this]() noexcept {
+            return finished_.load() == count_ && active_workers_ == 0;
+        });
+        job_open_ = false;
+    }
+
+private:
+    void execute_tasks() noexcept {
+        size_t i;
+        while ((i = next_.fetch_add(1)) < count_) {
+            invoke_(task_, i);
+            finished_.fetch_add(1);
+        }
+    }
+
+    void work() noexcept {
+        size_t seen_generation = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            job_cv_.wait(lock, [&]() noexcept {
+                return stopped_ || (job_open_ && generation_ != seen_generation);
+            });
+            if (stopped_) {
+                return;
+            }
+            seen_generation = generation_;
+            active_workers_++;
+            lock.unlock();
+
+            execute_tasks();
+
+            lock.lock();
+            active_workers_--;
+            done_cv_.notify_all();
+        }
+    }
+
+    std::mutex run_mutex_;
+    std::mutex mutex_;
+    std::condition_variable job_cv_;
+    std::condition_variable done_cv_;
+
+    // Current job, modified only under mutex_ while no worker is executing it
+    void (*invoke_)(void*, size_t) noexcept = nullptr;
+    void* task_ = nullptr;
+    size_t count_ = 0;
+    std::atomic<size_t> next_{0};
+    std::atomic<size_t> finished_{0};
+    bool job_open_ = false;
+    size_t generation_ = 0;
+    size_t active_workers_ = 0;
+    bool stopped_ = false;
+
+    std::vector<std::thread> workers_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_THREAD_POOL_H
@@ -0,0 +1,141 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_TO_BINARY_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_TO_BINARY_H
+
+#include "binary.h"
+#include "traits.h"
+#include "value.h"
+
+#include "external/rapidjson/document.h"
+
+#include <cassert>
+#include <string>
+#include <type_traits>
+
+namespace json_model {
+
+// Writer is MsgPackWriter or CborWriter
+
+template<typename Writer>
+void json_value_to_binary(Writer& writer, const json_value_t& value) noexcept {
+    if (value.IsNull()) {
+        writer.write_null();
+    } else if (value.IsBool()) {
+        writer.write_bool(value.GetBool());
+    } else if (value.IsInt64()) {
+        writer.write_int(value.GetInt64());
+    } else if (value.IsUint64()) {
+        writer.write_uint(value.GetUint64());
+    } else if (value.IsNumber()) {
+        writer.write_double(value.GetDouble());
+    } else if (value.IsString()) {
+        writer.write_string(value.GetString(), value.GetStringLength());
+    } else if (value.IsArray()) {
+        writer.start_array(value.Size());
+        for (const auto& item : value.GetArray()) {
+            json_value_to_binary(writer, item);
+        }
+    } else {
+        writer.start_map(value.MemberCount());
+        for (auto iter = value.MemberBegin(); iter != value.MemberEnd(); ++iter) {
+            writer.write_string(iter->name.GetString(), iter->name.GetStringLength());
+            json_value_to_binary(writer, iter->value);
+        }
+    }
+}
+
+template<typename Writer, typename T>
+typename std::enable_if_t<is_primitive_v<T>>
+to_binary(Writer& writer, const T& value) noexcept {
+    if constexpr (is_enum_v<T>) {
+        std::string_view name = EnumTable<T>::get_name(value);
+        writer.write_string(name.data(), name.size());
+    } else if constexpr (std::is_same_v<T, bool>) {
+        writer.write_bool(value);
+    } else if constexpr (std::is_same_v<T, double>) {
+        writer.write_double(value);
+    } else if constexpr (std::is_same_v<T, int> || std::is_same_v<T, int64_t>) {
+        writer.write_int(value);
+    } else if constexpr (std::is_same_v<T, unsigned> || std::is_same_v<T, uint64_t>) {
+        writer.write_uint(value);
+    } else if constexpr (std::is_same_v<T, std::string>) {
+        writer.write_string(value.data(), value.size());
+    } else if constexpr (std::is_same_v<T, Bytes>) {
+        // Readers decode binary data into JSON documents, so bytes are written as base64 strings, same as in JSON
+        std::string encoded(base64_encoded_size(value.size()), '\0');
+        base64_encode(value.data(), value.data() + value.size(), encoded.data());
+        writer.write_string(encoded.data(), encoded.size());
+    } else if constexpr (std::is_same_v<T, RawNumber>) {
+        // Binary formats have no decimal numbers, so only integers are written exactly
+        int64_t int_value;
+        uint64_t uint_value;
+        if (value.to_int64(int_value)) {
+            writer.write_int(int_value);
+        } else if (value.to_uint64(uint_value)) {
+            writer.write_uint(uint_value);
+        } else {
+            writer.write_double(value.to_double());
+        }
+    } else if constexpr (std::is_same_v<T, RawJson>) {
+        // Binary formats have no raw values, so text is parsed and written as value
+        rapidjson::Document document;
+        document.Parse(value.get_text().data(), value.get_text().size());
+        json_value_to_binary(writer, document);
+    } else if constexpr (std::is_same_v<T, Value>) {
+        json_value_to_binary(writer, value.get_value());
+    } else if constexpr (std::is_same_v<T, std::nullptr_t>) {
+        writer.write_null();
+    }
+}
+
+template<typename Writer, typename T>
+typename std::enable_if_t<is_pointer_v<T>>
+to_binary(Writer& writer, const T& value) noexcept {
+    assert(value);
+    value->to_binary_internal(writer);
+}
+
+template<typename Writer, typename T>
+typename std::enable_if_t<is_map_v<T>>
+to_binary(Writer& writer, const T& value) noexcept;
+
+template<typename Writer, typename T>
+typename std::enable_if_t<is_variant_v<T>>
+to_binary(Writer& writer, const T& value) noexcept;
+
+template<typename Writer, typename T>
+typename std::enable_if_t<is_vector_v<T>>
+to_binary(Writer& writer, const T& value) noexcept {
+    writer.start_array(value.size());
+    for (size_t i = 0; i < value.size(); ++i) {
+        to_binary(writer, value[i]);
+    }
+}
+
+template<typename Writer, typename T>
+typename std::enable_if_t<is_map_v<T>>
+to_binary(Writer& writer, const T& value) noexcept {
+    writer.start_map(value.size());
+    for (const auto& item : value) {
+        writer.write_string(item.first.data(), item.first.size());
+        to_binary(writer, item.second);
+    }
+}
+
+template<typename Writer, typename T>
+typename std::enable_if_t<is_variant_v<T>>
+to_binary(Writer& writer, const T& value) noexcept {
+    assert(!value.valueless_by_exception());
+    std::visit(
+        [&writer](auto&& arg) noexcept {
+            to_binary(writer, arg);
+        }, value
+    );
+}
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_TO_BINARY_H
@@ -7,15 +7,44 @@
 
 #include "traits.h"
 #include "types.h"
+#include "value.h"
 
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <string>
 #include <type_traits>
+#include <vector>
 
 namespace json_model {
 
+// Type of JSON value by its first character
+inline rapidjson::Type get_raw_json_type(const std::string& json) noexcept {
+    switch (json.empty() ? 'n' : json[0]) {
+        case '{':
+            return rapidjson::kObjectType;
+        case '[':
+            return rapidjson::kArrayType;
+        case '"':
+            return rapidjson::kStringType;
+        case 't':
+            return rapidjson::kTrueType;
+        case 'f':
+            return rapidjson::kFalseType;
+        case 'n':
+            return rapidjson::kNullType;
+        default:
+            return rapidjson::kNumberType;
+    }
+}
+
 template<typename T>
 typename std::enable_if_t<is_primitive_v<T>>
 to_json(json_writer_t& writer, const T& value) noexcept {
-    if constexpr (std::is_same_v<T, bool>) {
+    if constexpr (is_enum_v<T>) {
+        const FieldKey& literal = get_enum_literal(value);
+        writer.write_raw(literal.data() + 1, literal.size() - 1, rapidjson::kStringType);
+    } else if constexpr (std::is_same_v<T, bool>) {
         writer.Bool(value);
     } else if constexpr (std::is_same_v<T, double>) {
         writer.Double(value);
@@ -29,6 +58,14 @@ to_json(json_writer_t& writer, const T& value) noexcept {
         writer.Uint64(value);
     } else if constexpr (std::is_same_v<T, std::string>) {
         writer.String(value.c_str(), value.size(), true);
+    } else if constexpr (std::is_same_v<T, Bytes>) {
+        writer.write_base64(value.data(), value.size());
+    } else if constexpr (std::is_same_v<T, RawNumber>) {
+        writer.write_raw(value.get_text().data(), value.get_text().size(), rapidjson::kNumberType);
+    } else if constexpr (std::is_same_v<T, RawJson>) {
+        writer.write_raw(value.get_text().data(), value.get_text().size(), get_raw_json_type(value.get_text()));
+    } else if constexpr (std::is_same_v<T, Value>) {
+        value.get_value().Accept(writer);
     } else if constexpr (std::is_same_v<T, std::nullptr_t>) {
         writer.Null();
     }
@@ -38,7 +75,9 @@ template<typename T>
 typename std::enable_if_t<is_pointer_v<T>>
 to_json(json_writer_t& writer, const T& value) noexcept {
     assert(value);
+    const FieldKey* next_key = writer.get_next_key();
     value->to_json_internal(writer);
+    writer.restore_next_key(next_key);
 }
 
 template<typename T>
@@ -49,12 +88,75 @@ template<typename T>
 typename std::enable_if_t<is_variant_v<T>>
 to_json(json_writer_t& writer, const T& value) noexcept;
 
+template<typename T>
+typename std::enable_if_t<is_vector_v<T>>
+to_json(json_writer_t& writer, const T& value) noexcept;
+
+inline constexpr size_t PARALLEL_CHUNK_SIZE = 1024;
+
+// Serializes container in chunks on writer's thread pool, and writes chunks in order. Chunks are processed in rounds,
+// so that memory used for them doesn't depend on container size. Containers nested into chunks are serialized
+// sequentially
+template<typename T>
+void to_json_parallel(json_writer_t& writer, const T& value) noexcept {
+    ThreadPool& thread_pool = writer.get_thread_pool();
+    const size_t round_size = thread_pool.get_concurrency() * 4;
+    std::vector<std::string> chunks(round_size);
+    std::vector<typename T::const_iterator> bounds(round_size + 1);
+    auto iter = value.begin();
+    size_t left = value.size();
+    while (left != 0) {
+        size_t chunk_count = 0;
+        bounds[0] = iter;
+        while (chunk_count < round_size && left != 0) {
+            size_t chunk_size = std::min(left, PARALLEL_CHUNK_SIZE);
+            std::advance(iter, chunk_size);
+            left -= chunk_size;
+            bounds[++chunk_count] = iter;
+        }
+
+        auto task = [&](size_t chunk) noexcept {
+            chunks[chunk].clear();
+            StringSink sink(chunks[chunk]);
+            auto stream = std::make_unique<OutputStream>(sink);
+            json_writer_t chunk_writer(*stream);
+            chunk_writer.SetMaxDecimalPlaces(writer.GetMaxDecimalPlaces());
+            chunk_writer.set_cache_owner(writer.get_cache_owner());
+            if constexpr (is_map_v<T>) {
+                chunk_writer.StartObject();
+                for (auto it = bounds[chunk]; it != bounds[chunk + 1]; ++it) {
+                    chunk_writer.Key(it->first.c_str(), it->first.size());
+                    to_json(chunk_writer, it->second);
+                }
+                chunk_writer.EndObject();
+            } else {
+                chunk_writer.StartArray();
+                for (auto it = bounds[chunk]; it != bounds[chunk + 1]; ++it) {
+                    to_json(chunk_writer, *it);
+                }
+                chunk_writer.EndArray();
+            }
+        };
+        thread_pool.run(chunk_count, task);
+
+        for (size_t i = 0; i < chunk_count; ++i) {
+            // Strip brackets of chunk's array or object
+            size_t values = static_cast<size_t>(std::distance(bounds[i], bounds[i + 1])) * (is_map_v<T> ? 2 : 1);
+            writer.write_raw_values(chunks[i].data() + 1, chunks[i].size() - 2, values);
+        }
+    }
+}
+
 template<typename T>
 typename std::enable_if_t<is_vector_v<T>>
 to_json(json_writer_t& writer, const T& value) noexcept {
     writer.StartArray();
-    for (size_t i = 0; i < value.size(); ++i) {
-        to_json(writer, value[i]);
+    if (writer.is_parallel(value.size())) {
+        to_json_parallel(writer, value);
+    } else {
+        for (size_t i = 0; i < value.size(); ++i) {
+            to_json(writer, value[i]);
+        }
     }
     writer.EndArray();
 }
@@ -63,9 +165,13 @@ template<typename T>
 typename std::enable_if_t<is_map_v<T>>
 to_json(json_writer_t& writer, const T& value) noexcept {
     writer.StartObject();
-    for (const auto& item : value) {
-        writer.Key(item.first.c_str());
-        to_json(writer, item.second);
+    if (writer.is_parallel(value.size())) {
+        to_json_parallel(writer, value);
+    } else {
+        for (const auto& item : value) {
+            writer.Key(item.first.c_str(), item.first.size());
+            to_json(writer, item.second);
+        }
     }
     writer.EndObject();
 }
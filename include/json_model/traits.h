@@ -5,6 +5,12 @@
 #ifndef JSON_MODEL_INCLUDE_JSON_MODEL_TRAITS_H
 #define JSON_MODEL_INCLUDE_JSON_MODEL_TRAITS_H
 
+#include "bytes.h"
+#include "enum.h"
+#include "raw.h"
+#include "small_vector.h"
+
+#include <array>
 #include <type_traits>
 #include <map>
 #include <vector>
@@ -18,9 +24,21 @@
 namespace json_model {
 
 class Model;
+class Value;
+
+// Enums declared with JSON_MODEL_ENUM
+template<typename T, typename = void>
+struct is_enum : std::false_type {};
+
+template<typename T>
+struct is_enum<T, std::void_t<decltype(json_model_enum_names(std::declval<T>()))>> : std::is_enum<T> {};
+
+template<typename T>
+inline constexpr bool is_enum_v = is_enum<T>::value;
 
 template<typename T>
 struct is_primitive : std::disjunction<
+    is_enum<T>,
     std::is_same<T, bool>,
     std::is_same<T, double>,
     std::is_same<T, int>,
@@ -28,6 +46,10 @@ struct is_primitive : std::disjunction<
     std::is_same<T, unsigned>,
     std::is_same<T, uint64_t>,
     std::is_same<T, std::string>,
+    std::is_same<T, Bytes>,
+    std::is_same<T, RawNumber>,
+    std::is_same<T, RawJson>,
+    std::is_same<T, Value>,
     std::is_same<T, std::nullptr_t>> {
 };
 
@@ -77,9 +99,22 @@ struct is_map<std::map<std::string, T>> : is_containable<T> {};
 template<typename T>
 struct is_map<std::unordered_map<std::string, T>> : is_containable<T> {};
 
+// Sequences are std::vector, std::array and SmallVector. Size of std::array is checked when parsing
 template<typename T>
 struct is_vector<std::vector<T>> : is_containable<T> {};
 
+template<typename T, size_t N>
+struct is_vector<std::array<T, N>> : is_containable<T> {};
+
+template<typename T, size_t N>
+struct is_vector<SmallVector<T, N>> : is_containable<T> {};
+
+template<typename T>
+struct is_array : std::false_type {};
+
+template<typename T, size_t N>
+struct is_array<std::array<T, N>> : is_containable<T> {};
+
 template<typename Arg, typename... Args>
 struct is_variant<std::variant<Arg, Args...>> :
     std::conjunction<
@@ -107,6 +142,9 @@ inline constexpr bool is_vector_v = is_vector<T>::value;
 template<typename T>
 inline constexpr bool is_variant_v = is_variant<T>::value;
 
+template<typename T>
+inline constexpr bool is_array_v = is_array<T>::value;
+
 template<typename T>
 struct is_optional : std::false_type {};
 
@@ -5,15 +5,11 @@
 #ifndef JSON_MODEL_INCLUDE_JSON_MODEL_TYPES_H
 #define JSON_MODEL_INCLUDE_JSON_MODEL_TYPES_H
 
-#include "external/rapidjson/writer.h"
-#include "external/rapidjson/stringbuffer.h"
-#include "external/rapidjson/document.h"
-
-namespace json_model {
+// json_writer_t and json_value_t are declared in fwd.h, this header makes them complete
 
-using json_writer_t = rapidjson::Writer<rapidjson::StringBuffer>;
-using json_value_t = rapidjson::Value;
+#include "fwd.h"
+#include "writer.h"
 
-} // namespace json_model
+#include "external/rapidjson/document.h"
 
 #endif // JSON_MODEL_INCLUDE_JSON_MODEL_TYPES_H
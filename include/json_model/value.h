@@ -0,0 +1,97 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_VALUE_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_VALUE_H
+
+#include "fwd.h"
+
+#include "external/rapidjson/document.h"
+
+#include <memory>
+#include <utility>
+
+namespace json_model {
+
+using json_allocator_t = rapidjson::Document::AllocatorType;
+
+// Dynamic JSON value, for schemaless parts of models which are inspected with rapidjson API. When model is parsed from
+// JSON, value is moved out of the parsed document together with shared ownership of its allocator, so that nothing is
+// copied. Memory of the whole document is kept until all values parsed from it are destroyed or reassigned
+class Value {
+public:
+    Value() noexcept = default;
+
+    // Copies value
+    explicit Value(const json_value_t& value) noexcept {
+        copy_from(value);
+    }
+
+    Value(const Value& other) noexcept {
+        copy_from(other.value_);
+    }
+
+    Value(Value&& other) noexcept = default;
+
+    Value& operator=(const Value& other) noexcept {
+        if (this != &other) {
+            copy_from(other.value_);
+        }
+        return *this;
+    }
+
+    Value& operator=(Value&& other) noexcept = default;
+
+    ~Value() noexcept = default;
+
+    const json_value_t& get_value() const noexcept {
+        return value_;
+    }
+
+    // Value must be modified with get_allocator(). Values parsed from the same document share allocator, so they must
+    // not be modified from different threads at once
+    json_value_t& get_value() noexcept {
+        return value_;
+    }
+
+    json_allocator_t& get_allocator() noexcept {
+        if (!allocator_) {
+            allocator_ = std::make_shared<json_allocator_t>();
+        }
+        return *allocator_;
+    }
+
+    // Takes value, leaving null in its place. Value must be allocated with allocator
+    void assign(json_value_t& value, std::shared_ptr<json_allocator_t> allocator) noexcept {
+        value_.SetNull();
+        allocator_ = std::move(allocator);
+        value_.Swap(value);
+    }
+
+    // Copies value with a new allocator, as the current one may be shared with other values. Value may be a part of
+    // this value
+    void copy_from(const json_value_t& value) noexcept {
+        auto allocator = std::make_shared<json_allocator_t>();
+        json_value_t copy(value, *allocator);
+        value_.Swap(copy);
+        allocator_.swap(allocator);
+    }
+
+    bool operator==(const Value& other) const noexcept {
+        return value_ == other.value_;
+    }
+
+    bool operator!=(const Value& other) const noexcept {
+        return value_ != other.value_;
+    }
+
+private:
+    // Allocator is declared first, so that it outlives value
+    std::shared_ptr<json_allocator_t> allocator_;
+    json_value_t value_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_VALUE_H
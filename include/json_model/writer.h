@@ -0,0 +1,279 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_INCLUDE_JSON_MODEL_WRITER_H
+#define JSON_MODEL_INCLUDE_JSON_MODEL_WRITER_H
+
+#include "bytes.h"
+#include "enum.h"
+#include "fwd.h"
+#include "escape.h"
+#include "stream.h"
+#include "thread_pool.h"
+
+#include "external/rapidjson/writer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace json_model {
+
+// Object key in its serialized form: comma, then quoted and escaped name
+class FieldKey {
+public:
+    explicit FieldKey(const char* name) noexcept: escaped_(",") {
+        StringSink sink(escaped_);
+        OutputStream stream(sink);
+        rapidjson::Writer<OutputStream> writer(stream);
+        writer.String(name);
+        writer.Flush();
+    }
+
+    const char* data() const noexcept {
+        return escaped_.data();
+    }
+
+    size_t size() const noexcept {
+        return escaped_.size();
+    }
+
+private:
+    std::string escaped_;
+};
+
+// Quoted and escaped names of enum values. FieldKey is reused, so that literals are preceded by a comma. Values out of
+// range are written as empty string, same as in binary formats
+template<typename E>
+const FieldKey& get_enum_literal(E value) noexcept {
+    static const KeyTable literals = []() noexcept {
+        KeyTable result;
+        for (std::string_view name : EnumTable<E>::NAMES) {
+            result.emplace_back(std::string(name).c_str());
+        }
+        result.emplace_back("");
+        return result;
+    }();
+    auto index = static_cast<size_t>(value);
+    return literals[std::min(index, EnumTable<E>::SIZE)];
+}
+
+class KeyCollector {
+public:
+    void add(const char* name) noexcept {
+        keys_.emplace_back(name);
+    }
+
+    KeyTable release() noexcept {
+        return std::move(keys_);
+    }
+
+private:
+    KeyTable keys_;
+};
+
+class Writer : public rapidjson::Writer<OutputStream> {
+public:
+    explicit Writer(OutputStream& os) noexcept
+        : rapidjson::Writer<OutputStream>(os), next_key_(nullptr), thread_pool_(nullptr), min_parallel_size_(0),
+          cache_owner_(nullptr) {}
+
+    // Vectors and maps of at least `min_parallel_size` elements will be serialized in parallel on the pool
+    void set_thread_pool(ThreadPool* thread_pool, size_t min_parallel_size) noexcept {
+        thread_pool_ = thread_pool;
+        min_parallel_size_ = min_parallel_size;
+    }
+
+    bool is_parallel(size_t size) const noexcept {
+        return thread_pool_ != nullptr && size >= min_parallel_size_;
+    }
+
+    ThreadPool& get_thread_pool() const noexcept {
+        assert(thread_pool_ != nullptr);
+        return *thread_pool_;
+    }
+
+    // Cached model whose JSON is being written, nested cached models are linked to it
+    void set_cache_owner(const CachedModel* cache_owner) noexcept {
+        cache_owner_ = cache_owner;
+    }
+
+    const CachedModel* get_cache_owner() const noexcept {
+        return cache_owner_;
+    }
+
+    // Model fields are written in order of declaration, so keys are taken from model's key table one by one
+    void set_keys(const KeyTable& keys) noexcept {
+        next_key_ = keys.data();
+    }
+
+    const FieldKey* get_next_key() const noexcept {
+        return next_key_;
+    }
+
+    void restore_next_key(const FieldKey* next_key) noexcept {
+        next_key_ = next_key;
+    }
+
+    const FieldKey& next_key() noexcept {
+        assert(next_key_ != nullptr);
+        return *next_key_++;
+    }
+
+    // Same as Key(), but emits precomputed bytes with a single copy
+    void write_key(const FieldKey& key) noexcept {
+        assert(level_stack_.GetSize() != 0);
+        Level* level = level_stack_.Top<Level>();
+        assert(!level->inArray && level->valueCount % 2 == 0);
+        size_t skip = (level->valueCount == 0 ? 1 : 0);
+        os_->write(key.data() + skip, key.size() - skip);
+        level->valueCount++;
+    }
+
+    // Runs of characters which don't need escaping are found with SIMD and copied in bulk
+    bool String(const Ch* str, rapidjson::SizeType length, bool = false) noexcept {
+        Prefix(rapidjson::kStringType);
+        os_->Put('"');
+        const char* end = str + length;
+        while (true) {
+            const char* escape = find_escape(str, end);
+            os_->write(str, static_cast<size_t>(escape - str));
+            if (escape == end) {
+                break;
+            }
+            os_->advance(write_escape(*escape, os_->get_buffer(6)));
+            str = escape + 1;
+        }
+        os_->Put('"');
+        return EndValue(true);
+    }
+
+    bool Key(const Ch* str, rapidjson::SizeType length, bool = false) noexcept {
+        return String(str, length);
+    }
+
+    // Encodes data as base64 string directly into the stream buffer
+    bool write_base64(const uint8_t* data, size_t size) noexcept {
+        Prefix(rapidjson::kStringType);
+        os_->Put('"');
+        const uint8_t* end = data + size;
+        while (data != end) {
+            const uint8_t* chunk_end = data + std::min(static_cast<size_t>(end - data), BASE64_CHUNK_SIZE);
+            os_->advance(base64_encode(data, chunk_end, os_->get_buffer(base64_encoded_size(BASE64_CHUNK_SIZE))));
+            data = chunk_end;
+        }
+        os_->Put('"');
+        return EndValue(true);
+    }
+
+    // Same as RawValue(), but copies json in bulk
+    bool write_raw(const char* json, size_t length, rapidjson::Type type) noexcept {
+        Prefix(type);
+        os_->write(json, length);
+        return EndValue(true);
+    }
+
+    // Writes `values` serialized array elements or object members (counting both keys and values), separated with
+    // commas, into the current array or object
+    void write_raw_values(const char* json, size_t length, size_t values) noexcept {
+        assert(level_stack_.GetSize() != 0);
+        if (values == 0) return;
+        Level* level = level_stack_.Top<Level>();
+        if (level->valueCount != 0) {
+            os_->Put(',');
+        }
+        os_->write(json, length);
+        level->valueCount += values;
+    }
+
+    // Numbers are formatted with std::to_chars directly into the stream buffer
+
+    bool Int(int i) noexcept {
+        return write_integer(i);
+    }
+
+    bool Uint(unsigned u) noexcept {
+        return write_integer(u);
+    }
+
+    bool Int64(int64_t i64) noexcept {
+        return write_integer(i64);
+    }
+
+    bool Uint64(uint64_t u64) noexcept {
+        return write_integer(u64);
+    }
+
+    // Shortest representation which round-trips, e.g. 3.14159, 3.0 or 1e+21. If max decimal places are set, value is
+    // rounded to them whenever shortest representation has more decimals, e.g. 1.2346e-05 is written as 0.00001235
+    // with 8 places
+    bool Double(double d) noexcept {
+#if defined(__cpp_lib_to_chars)
+        if (!std::isfinite(d)) {
+            return rapidjson::Writer<OutputStream>::Double(d);
+        }
+        Prefix(rapidjson::kNumberType);
+        // Rounded value has at most 17 digits before the point, as larger values have no decimals
+        size_t max_size = MAX_NUMBER_SIZE + static_cast<size_t>(std::min(maxDecimalPlaces_, MAX_DECIMAL_PLACES));
+        char* begin = os_->get_buffer(max_size);
+        char* end = std::to_chars(begin, begin + max_size, d).ptr;
+        if (maxDecimalPlaces_ != kDefaultMaxDecimalPlaces && count_decimal_places(begin, end) > maxDecimalPlaces_) {
+            end = std::to_chars(begin, begin + max_size, d, std::chars_format::fixed, maxDecimalPlaces_).ptr;
+            while (end[-1] == '0' && end[-2] != '.') {
+                end--;
+            }
+        }
+        if (std::find_if(begin, end, [](char c) { return c == '.' || c == 'e'; }) == end) {
+            *end++ = '.';
+            *end++ = '0';
+        }
+        os_->advance(end);
+        return EndValue(true);
+#else
+        return rapidjson::Writer<OutputStream>::Double(d);
+#endif
+    }
+
+private:
+    // Number of decimals of value formatted by std::to_chars, including those implied by negative exponent
+    static int count_decimal_places(const char* begin, const char* end) noexcept {
+        const char* exponent = std::find(begin, end, 'e');
+        const char* point = std::find(begin, exponent, '.');
+        int count = point == exponent ? 0 : static_cast<int>(exponent - point - 1);
+        if (exponent != end) {
+            int power = 0;
+            std::from_chars(exponent + (exponent[1] == '+' ? 2 : 1), end, power);
+            count -= power;
+        }
+        return count;
+    }
+
+    template<typename T>
+    bool write_integer(T value) noexcept {
+        Prefix(rapidjson::kNumberType);
+        char* begin = os_->get_buffer(MAX_NUMBER_SIZE);
+        os_->advance(std::to_chars(begin, begin + MAX_NUMBER_SIZE, value).ptr);
+        return EndValue(true);
+    }
+
+    static constexpr size_t MAX_NUMBER_SIZE = 64;
+    // Shortest form of doubles has no more decimals than this, e.g. 2.2250738585072014e-308, so values are never
+    // rounded to more places
+    static constexpr int MAX_DECIMAL_PLACES = 330;
+    // Multiple of 3, so that padding is written only at the end
+    static constexpr size_t BASE64_CHUNK_SIZE = 3 * 1024;
+
+    const FieldKey* next_key_;
+    ThreadPool* thread_pool_;
+    size_t min_parallel_size_;
+    const CachedModel* cache_owner_;
+};
+
+} // namespace json_model
+
+#endif // JSON_MODEL_INCLUDE_JSON_MODEL_WRITER_H
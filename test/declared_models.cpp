@@ -0,0 +1,33 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#include "declared_models.h"
+
+#include <json_model/model.h>
+
+namespace json_model::test_declare {
+
+JSON_MODEL_DEFINE(
+    Item,
+    name(_, "name"),
+    price(_, "price", json_model::max_decimal_places(2))
+);
+
+JSON_MODEL_DEFINE(
+    Order,
+    id(_, "id"),
+    items(_, "items"),
+    tags(_, "tags"),
+    comment(_, "comment")
+);
+
+size_t count_fields(const Order& order) {
+    size_t count = 0;
+    json_model::for_each_field(order, [&count](const char*, const auto&) {
+        ++count;
+    });
+    return count;
+}
+
+} // namespace json_model::test_declare
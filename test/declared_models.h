@@ -0,0 +1,45 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#ifndef JSON_MODEL_TEST_DECLARED_MODELS_H
+#define JSON_MODEL_TEST_DECLARED_MODELS_H
+
+#include <json_model/fwd.h>
+
+#if defined(JSON_MODEL_INCLUDE_JSON_MODEL_TRAITS_H) || defined(JSON_MODEL_INCLUDE_JSON_MODEL_BYTES_H)
+#error "fwd.h must not include headers of field types"
+#endif
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Models which are declared with lightweight header and defined in declared_models.cpp
+
+namespace json_model::test_declare {
+
+struct Item final : public json_model::Model {
+    DECLARE_FIELD(name, std::string);
+    DECLARE_FIELD(price, double);
+
+    JSON_MODEL_DECLARE(Item)
+};
+
+struct Order : public json_model::CachedModel {
+    DECLARE_FIELD(id, int64_t);
+    DECLARE_FIELD(items, std::vector<std::unique_ptr<Item>>);
+    DECLARE_FIELD(tags, std::map<std::string, std::string>);
+    DECLARE_FIELD(comment, std::optional<std::string>);
+
+    JSON_MODEL_DECLARE(Order)
+};
+
+// Defined in declared_models.cpp, where for_each_field() is available
+size_t count_fields(const Order& order);
+
+} // namespace json_model::test_declare
+
+#endif // JSON_MODEL_TEST_DECLARED_MODELS_H
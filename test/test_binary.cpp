@@ -0,0 +1,402 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#include <json_model/model.h>
+#include <json_model/snapshot_view.h>
+
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#include <string>
+
+namespace json_model::test_binary {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace round_trip {
+
+struct Nested : public json_model::Model {
+    DECLARE_FIELD(id, int);
+    DECLARE_FIELD(tags, std::vector<std::string>);
+
+    PROVIDE_DETAILS(
+        Nested,
+        id(_, "id"),
+        tags(_, "tags")
+    )
+};
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(flag, bool);
+    DECLARE_FIELD(small, int);
+    DECLARE_FIELD(negative, int64_t);
+    DECLARE_FIELD(big, uint64_t);
+    DECLARE_FIELD(count, unsigned);
+    DECLARE_FIELD(ratio, double);
+    DECLARE_FIELD(name, std::string);
+    DECLARE_FIELD(nothing, std::nullptr_t);
+    DECLARE_FIELD(numbers, std::vector<int64_t>);
+    DECLARE_FIELD(attributes, std::map<std::string, std::string>);
+    DECLARE_FIELD(variant, std::variant<int, std::string, std::unique_ptr<Nested>>);
+    DECLARE_FIELD(present, std::optional<std::string>);
+    DECLARE_FIELD(absent, std::optional<int>);
+    DECLARE_FIELD(nested, std::unique_ptr<Nested>);
+    DECLARE_FIELD(children, std::vector<std::unique_ptr<Nested>>);
+
+    PROVIDE_DETAILS(
+        Model,
+        flag(_, "flag"),
+        small(_, "small"),
+        negative(_, "negative"),
+        big(_, "big"),
+        count(_, "count"),
+        ratio(_, "ratio"),
+        name(_, "name"),
+        nothing(_, "nothing"),
+        numbers(_, "numbers"),
+        attributes(_, "attributes"),
+        variant(_, "variant"),
+        present(_, "present"),
+        absent(_, "absent"),
+        nested(_, "nested"),
+        children(_, "children")
+    )
+};
+
+void fill(Model& model) {
+    model.set_flag(true);
+    model.set_small(-5);
+    model.set_negative(std::numeric_limits<int64_t>::min());
+    model.set_big(std::numeric_limits<uint64_t>::max());
+    model.set_count(70000u);
+    model.set_ratio(-0.1);
+    model.set_name(std::string(300, 'x'));
+    for (int64_t value : {int64_t(0), int64_t(127), int64_t(-32), int64_t(-33), int64_t(200), int64_t(-200),
+                          int64_t(40000), int64_t(-40000), int64_t(1) << 40, -(int64_t(1) << 40)}) {
+        model.get_numbers().push_back(value);
+    }
+    for (int i = 0; i < 20; ++i) {
+        model.get_attributes()["key" + std::to_string(i)] = std::string(static_cast<size_t>(i) * 3, 'a');
+    }
+    auto variant = std::make_unique<Nested>();
+    variant->set_id(7);
+    model.set_variant(std::move(variant));
+    model.set_present("here");
+    model.get_nested()->set_id(1);
+    model.get_nested()->get_tags() = {"a", "\"quoted\"", ""};
+    model.get_children().push_back(std::make_unique<Nested>());
+}
+
+TEST(binary, round_trip) {
+    Model model;
+    fill(model);
+    std::string json = model.to_json();
+
+    Model from_msgpack;
+    ASSERT_TRUE(from_msgpack.from_msgpack(model.to_msgpack()));
+    ASSERT_EQ(from_msgpack.to_json(), json);
+
+    Model from_cbor;
+    ASSERT_TRUE(from_cbor.from_cbor(model.to_cbor()));
+    ASSERT_EQ(from_cbor.to_json(), json);
+
+    ASSERT_LT(model.to_msgpack().size(), json.size());
+    ASSERT_LT(model.to_cbor().size(), json.size());
+}
+
+} // namespace round_trip
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace encoding {
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(a, int);
+    DECLARE_FIELD(b, std::string);
+    DECLARE_FIELD(c, std::optional<bool>);
+
+    PROVIDE_DETAILS(
+        Model,
+        a(_, "a"),
+        b(_, "b"),
+        c(_, "c")
+    )
+};
+
+struct Doubles : public json_model::Model {
+    DECLARE_FIELD(values, std::vector<double>);
+
+    PROVIDE_DETAILS(
+        Doubles,
+        values(_, "values")
+    )
+};
+
+TEST(binary, encoding) {
+    Model model;
+    model.set_a(1);
+    model.set_b("x");
+    ASSERT_EQ(model.to_msgpack(), std::string("\x82\xa1" "a\x01\xa1" "b\xa1x"));
+    ASSERT_EQ(model.to_cbor(), std::string("\xa2\x61" "a\x01\x61" "b\x61x"));
+
+    model.set_c(false);
+    ASSERT_EQ(model.to_msgpack(), std::string("\x83\xa1" "a\x01\xa1" "b\xa1x\xa1" "c\xc2"));
+    ASSERT_EQ(model.to_cbor(), std::string("\xa3\x61" "a\x01\x61" "b\x61x\x61" "c\xf4"));
+
+    // Indefinite length map, array and string, and floats of all sizes in CBOR
+    Doubles doubles;
+    std::string cbor("\xbf\x66values\x9f\xf9\x3c\x00\xfa\x3f\xc0\x00\x00\xfb\x40\x04\x00\x00\x00\x00\x00\x00\xff\xff", 28);
+    ASSERT_TRUE(doubles.from_cbor(cbor));
+    ASSERT_EQ(doubles.get_values(), std::vector<double>({1.0, 1.5, 2.5}));
+
+    ASSERT_TRUE(model.from_cbor(std::string("\xa2\x61" "a\x20\x61" "b\x7f\x61x\x62yz\xff", 13)));
+    ASSERT_EQ(model.get_a(), -1);
+    ASSERT_EQ(model.get_b(), "xyz");
+    ASSERT_FALSE(model.get_c().has_value());
+
+    // float32 in MessagePack
+    ASSERT_TRUE(doubles.from_msgpack(std::string("\x81\xa6values\x91\xca\x3f\xc0\x00\x00", 14)));
+    ASSERT_EQ(doubles.get_values(), std::vector<double>({1.5}));
+}
+
+} // namespace encoding
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace errors {
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(a, int);
+    DECLARE_FIELD(b, std::vector<std::string>);
+
+    PROVIDE_DETAILS(
+        Model,
+        a(_, "a"),
+        b(_, "b")
+    )
+};
+
+TEST(binary, errors) {
+    Model model;
+    model.set_a(1);
+    model.get_b() = {"x", "y"};
+    std::string msgpack = model.to_msgpack();
+    std::string cbor = model.to_cbor();
+
+    try {
+        model.from_msgpack(msgpack.substr(0, msgpack.size() - 1));
+        FAIL() << "Expected exception";
+    } catch (json_model::DecodeError& error) {
+        ASSERT_EQ(error.get_compact(), "Cannot decode msgpack (offset " + std::to_string(msgpack.size() - 1) +
+                                       "): Unexpected end of data");
+    }
+    ASSERT_FALSE(model.from_msgpack(msgpack + "x", false));
+    ASSERT_FALSE(model.from_cbor(cbor.substr(0, 3), false));
+    ASSERT_FALSE(model.from_cbor(std::string("\xa1\x01\x01", 3), false));
+    ASSERT_THROW(model.from_msgpack(std::string("\x81\xc4\x01x\x01", 5)), json_model::DecodeError);
+
+    try {
+        // {"a": 1, "b": [1]}
+        model.from_msgpack(std::string("\x82\xa1" "a\x01\xa1" "b\x91\x01", 8));
+        FAIL() << "Expected exception";
+    } catch (json_model::TypeMismatchError& error) {
+        ASSERT_EQ(error.get_compact(), "Type mismatch at 'root[\"b\"][0]' (expected: string, actual: number)");
+    }
+
+    try {
+        // {"a": 1}
+        model.from_cbor(std::string("\xa1\x61" "a\x01", 4));
+        FAIL() << "Expected exception";
+    } catch (json_model::MissingKeyError& error) {
+        ASSERT_EQ(error.get_compact(), "Key 'b' missing at 'root'");
+    }
+    ASSERT_FALSE(model.from_cbor(std::string("\xa1\x61" "a\x01", 4), false));
+}
+
+} // namespace errors
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace snapshot {
+
+struct Node : public json_model::Model {
+    DECLARE_FIELD(name, std::string);
+    DECLARE_FIELD(children, std::vector<std::unique_ptr<Node>>);
+
+    PROVIDE_DETAILS(
+        Node,
+        name(_, "name"),
+        children(_, "children")
+    )
+};
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(flag, bool);
+    DECLARE_FIELD(negative, int);
+    DECLARE_FIELD(big, uint64_t);
+    DECLARE_FIELD(ratio, double);
+    DECLARE_FIELD(name, std::string);
+    DECLARE_FIELD(prices, std::vector<double>);
+    DECLARE_FIELD(attributes, std::unordered_map<std::string, std::vector<std::string>>);
+    DECLARE_FIELD(variant, std::variant<int, std::string>);
+    DECLARE_FIELD(present, std::optional<int64_t>);
+    DECLARE_FIELD(absent, std::optional<std::string>);
+    DECLARE_FIELD(tree, std::unique_ptr<Node>);
+
+    PROVIDE_DETAILS(
+        Model,
+        flag(_, "flag"),
+        negative(_, "negative"),
+        big(_, "big"),
+        ratio(_, "ratio"),
+        name(_, "name"),
+        prices(_, "prices"),
+        attributes(_, "attributes"),
+        variant(_, "variant"),
+        present(_, "present"),
+        absent(_, "absent"),
+        tree(_, "tree")
+    )
+};
+
+struct Renamed : public json_model::Model {
+    DECLARE_FIELD(flag, bool);
+
+    PROVIDE_DETAILS(
+        Renamed,
+        flag(_, "other_flag")
+    )
+};
+
+void check(json_model::RecordView<Model> view) {
+    using View = json_model::RecordView<Model>;
+    ASSERT_TRUE(view.get<bool>("flag"));
+    ASSERT_EQ(view.get<int>("negative"), -7);
+    ASSERT_EQ(view.get<uint64_t>("big"), std::numeric_limits<uint64_t>::max());
+    ASSERT_EQ(view.get<double>("ratio"), 0.25);
+    ASSERT_EQ(view.get<std::string>("name"), std::string(20, 'n'));
+
+    auto prices = view.get<std::vector<double>>(View::field_index("prices"));
+    ASSERT_EQ(prices.size(), 1000u);
+    ASSERT_EQ(prices[999], 999.5);
+
+    auto attributes = view.get<std::unordered_map<std::string, std::vector<std::string>>>("attributes");
+    ASSERT_EQ(attributes.size(), 3u);
+    ASSERT_EQ(attributes.key(0), "a");
+    ASSERT_EQ(attributes.key(2), "c");
+    ASSERT_EQ(attributes.find("d"), 3u);
+    ASSERT_FALSE(attributes.get("").has_value());
+    auto values = attributes.get("b");
+    ASSERT_TRUE(values.has_value());
+    ASSERT_EQ(values->size(), 2u);
+    ASSERT_EQ((*values)[1], "y");
+
+    auto variant = view.get<std::variant<int, std::string>>("variant");
+    ASSERT_EQ(variant.index(), 1u);
+    ASSERT_EQ(variant.get<1>(), "variant");
+
+    ASSERT_TRUE(view.has(View::field_index("present")));
+    ASSERT_EQ(view.get<std::optional<int64_t>>("present"), -(int64_t(1) << 40));
+    ASSERT_FALSE(view.has(View::field_index("absent")));
+    ASSERT_FALSE(view.get<std::optional<std::string>>("absent").has_value());
+
+    auto tree = view.get<std::unique_ptr<Node>>("tree");
+    ASSERT_EQ(tree.get<std::string>("name"), "root");
+    auto children = tree.get<std::vector<std::unique_ptr<Node>>>("children");
+    ASSERT_EQ(children.size(), 1u);
+    ASSERT_EQ(children[0].get<std::string>("name"), "child");
+    ASSERT_TRUE(children[0].get<std::vector<std::unique_ptr<Node>>>("children").empty());
+}
+
+TEST(binary, snapshot) {
+    Model model;
+    model.set_flag(true);
+    model.set_negative(-7);
+    model.set_big(std::numeric_limits<uint64_t>::max());
+    model.set_ratio(0.25);
+    model.set_name(std::string(20, 'n'));
+    for (int i = 0; i < 1000; ++i) {
+        model.get_prices().push_back(i + 0.5);
+    }
+    model.get_attributes()["c"] = {};
+    model.get_attributes()["a"] = {"x"};
+    model.get_attributes()["b"] = {"x", "y"};
+    model.set_variant("variant");
+    model.set_present(-(int64_t(1) << 40));
+    model.get_tree()->set_name("root");
+    model.get_tree()->get_children().push_back(std::make_unique<Node>());
+    model.get_tree()->get_children()[0]->set_name("child");
+
+    std::string snapshot = model.to_snapshot();
+    ASSERT_EQ(snapshot.size() % 8, 0u);
+    check(json_model::open_snapshot<Model>(snapshot.data(), snapshot.size()));
+
+    std::string path = testing::TempDir() + "json_model_snapshot";
+    std::FILE* file = std::fopen(path.c_str(), "wb");
+    ASSERT_NE(file, nullptr);
+    json_model::FileSink sink(file);
+    ASSERT_TRUE(model.to_snapshot(sink));
+    std::fclose(file);
+    json_model::MappedFile mapped_file;
+    ASSERT_TRUE(mapped_file.open(path.c_str()));
+    check(json_model::open_snapshot<Model>(mapped_file.data(), mapped_file.size()));
+    mapped_file.close();
+    std::remove(path.c_str());
+}
+
+TEST(binary, snapshot_errors) {
+    Model model;
+    std::string snapshot = model.to_snapshot();
+
+    ASSERT_THROW(json_model::open_snapshot<Model>(snapshot.data(), 16), json_model::DecodeError);
+    ASSERT_THROW(json_model::open_snapshot<Renamed>(snapshot.data(), snapshot.size()), json_model::DecodeError);
+    try {
+        json_model::open_snapshot<Node>(snapshot.data(), snapshot.size());
+        FAIL() << "Expected exception";
+    } catch (json_model::DecodeError& error) {
+        ASSERT_EQ(error.get_compact(), "Cannot decode snapshot (offset 16): Schema fingerprint mismatch");
+    }
+    std::string corrupted = snapshot;
+    corrupted[0] = 'X';
+    ASSERT_THROW(json_model::open_snapshot<Model>(corrupted.data(), corrupted.size()), json_model::DecodeError);
+
+    // Truncated snapshots are rejected, even if the footer of the full snapshot was written after truncated payloads
+    model.set_name("name");
+    model.get_prices() = {1, 2, 3};
+    model.get_attributes()["key"] = {"value"};
+    model.set_variant("variant");
+    model.get_tree()->get_children().push_back(std::make_unique<Node>());
+    snapshot = model.to_snapshot();
+    std::string footer = snapshot.substr(snapshot.size() - json_model::SNAPSHOT_FOOTER_SIZE);
+    for (size_t size = json_model::SNAPSHOT_HEADER_SIZE + 8; size < snapshot.size(); size += 8) {
+        std::string truncated = snapshot.substr(0, size);
+        ASSERT_THROW(json_model::open_snapshot<Model>(truncated.data(), truncated.size()), json_model::DecodeError);
+        truncated.replace(size - footer.size(), footer.size(), footer);
+        ASSERT_THROW(json_model::open_snapshot<Model>(truncated.data(), truncated.size()), json_model::DecodeError);
+    }
+    ASSERT_THROW(json_model::open_snapshot<Model>(snapshot.data(), snapshot.size() - 1), json_model::DecodeError);
+
+    // Words which hold offsets or lengths are checked
+    size_t rejected = 0;
+    for (size_t offset = json_model::SNAPSHOT_HEADER_SIZE; offset < snapshot.size(); offset += 8) {
+        corrupted = snapshot;
+        corrupted[offset + 6] = '\x7f';
+        try {
+            json_model::open_snapshot<Model>(corrupted.data(), corrupted.size());
+        } catch (json_model::DecodeError&) {
+            ++rejected;
+        }
+    }
+    ASSERT_GE(rejected, 15u);
+
+    ASSERT_NE(Model::snapshot_schema_internal().fingerprint, Renamed::snapshot_schema_internal().fingerprint);
+    ASSERT_EQ(Node::snapshot_schema_internal().signatures[1], "[@1]");
+}
+
+} // namespace snapshot
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace json_model::test_binary
@@ -0,0 +1,42 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#include "declared_models.h"
+
+#include <json_model/model.h>
+
+#include <gtest/gtest.h>
+#include <string>
+
+namespace json_model::test_declare {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace declare {
+
+TEST(declare, define) {
+    Order order;
+    ASSERT_EQ(order.to_json(), R"({"id":0,"items":[],"tags":{}})");
+
+    const std::string json = R"({"id":7,"items":[{"name":"a","price":1.25},{"name":"b","price":0.5}],)"
+                             R"("tags":{"k":"v"},"comment":"c"})";
+    ASSERT_TRUE(order.from_json(json));
+    ASSERT_EQ(order.get_items()[1]->get_name(), "b");
+    ASSERT_EQ(order.to_json(), json);
+    order.get_items()[0]->set_price(2.999);
+    ASSERT_EQ(order.to_json().substr(0, 41), R"({"id":7,"items":[{"name":"a","price":3.0})");
+
+    Order other;
+    ASSERT_TRUE(other.from_msgpack(order.to_msgpack()));
+    ASSERT_EQ(json_model::diff(order, other), "{}");
+    ASSERT_THROW(other.from_json(R"({"id":1,"items":[{}],"tags":{}})"), json_model::MissingKeyError);
+
+    ASSERT_EQ(json_model::test_declare::count_fields(order), 4u);
+}
+
+} // namespace declare
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace json_model::test_declare
@@ -153,6 +153,33 @@ TEST(error, type_mismatch) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace size_mismatch {
+
+TEST(error, size_mismatch) {
+    json_model::SizeMismatchError error(2, 3);
+    error.add_trace_index(1);
+    error.add_trace_key("points");
+    ASSERT_STREQ(
+        error.what(),
+        "Size mismatch"
+    );
+    ASSERT_EQ(
+        error.get_compact(),
+        R"(Size mismatch at 'root["points"][1]' (expected: 2, actual: 3))"
+    );
+    ASSERT_EQ(
+        error.get_prettified(),
+        "Array size mismatch:\n"
+        "   expected: root[\"points\"][1]\n"
+        "  which has: 3 elements\n"
+        "    to have: 2 elements"
+    );
+}
+
+} // namespace size_mismatch
+
+////////////////////////////////////////////////////////////////////////////////
+
 namespace missing_key {
 
 TEST(error, missing_key) {
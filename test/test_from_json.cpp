@@ -3,6 +3,8 @@
 //
 
 #include <json_model/model.h>
+#include <json_model/push_parser.h>
+#include <json_model/snapshot_view.h>
 
 #include <gtest/gtest.h>
 
@@ -414,6 +416,35 @@ TEST(from_json, vector) {
     );
 }
 
+struct Flags : public json_model::Model {
+    DECLARE_FIELD(flags, std::vector<bool>);
+
+    PROVIDE_DETAILS(
+        Flags,
+        flags(_, "flags")
+    )
+};
+
+TEST(from_json, vector_of_bool) {
+    Flags model;
+    ASSERT_TRUE(model.from_json(R"({"flags":[true,false]})"));
+    ASSERT_EQ(model.get_flags(), (std::vector<bool>{true, false}));
+    ASSERT_EQ(model.to_json(), R"({"flags":[true,false]})");
+
+    ASSERT_TRUE(model.from_json(R"({"flags":[false,true,true]})"));
+    ASSERT_EQ(model.to_json(), R"({"flags":[false,true,true]})");
+    ASSERT_TRUE(model.from_json(R"({"flags":[]})"));
+    ASSERT_TRUE(model.get_flags().empty());
+
+    try {
+        model.from_json(R"({"flags":[true,1]})");
+        FAIL() << "Expected exception";
+    } catch (json_model::TypeMismatchError& error) {
+        ASSERT_EQ(error.get_compact(), R"(Type mismatch at 'root["flags"][1]' (expected: bool, actual: number))");
+    }
+    ASSERT_FALSE(model.from_json(R"({"flags":[null]})", false));
+}
+
 } // namespace vector
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -636,4 +667,776 @@ TEST(from_json, variant) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace reuse {
+
+struct Nested : public json_model::Model {
+    DECLARE_FIELD(name, std::string);
+
+    PROVIDE_DETAILS(
+        Nested,
+        name(_, "name")
+    )
+};
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(text, std::string);
+    DECLARE_FIELD(children, std::vector<std::unique_ptr<Nested>>);
+    DECLARE_FIELD(items, std::map<std::string, std::unique_ptr<Nested>>);
+    DECLARE_FIELD(counts, std::unordered_map<std::string, std::vector<int>>);
+    DECLARE_FIELD(optional, std::optional<std::unique_ptr<Nested>>);
+    DECLARE_FIELD(variant, std::variant<int, std::string, std::unique_ptr<Nested>>);
+
+    PROVIDE_DETAILS(
+        Model,
+        text(_, "text"),
+        children(_, "children"),
+        items(_, "items"),
+        counts(_, "counts"),
+        optional(_, "optional"),
+        variant(_, "variant")
+    )
+};
+
+TEST(from_json, reuse) {
+    std::string long_text(100, 't');
+    Model model;
+    ASSERT_TRUE(model.from_json(
+        R"({"text":")" + long_text + R"(","children":[{"name":"a"},{"name":"b"}],"items":{"x":{"name":"x"},"y":{"name":"y"}},)"
+        R"("counts":{"p":[1,2]},"optional":{"name":"o"},"variant":{"name":"v"}})"
+    ));
+    const char* text = model.get_text().data();
+    const Nested* child = model.get_children()[0].get();
+    const Nested* item = model.get_items()["x"].get();
+    const Nested* stale_item = model.get_items()["y"].get();
+    const std::vector<int>* counts = &model.get_counts()["p"];
+    const Nested* optional = model.get_optional().value().get();
+    const Nested* variant = std::get<2>(model.get_variant()).get();
+
+    ASSERT_TRUE(model.from_json(
+        R"({"text":")" + long_text.substr(1) + R"(","children":[{"name":"c"},{"name":"d"},{"name":"e"}],)"
+        R"("items":{"x":{"name":"x2"},"z":{"name":"z"}},"counts":{"p":[3]},"optional":{"name":"o2"},"variant":{"name":"v2"}})"
+    ));
+    ASSERT_EQ(model.get_text().data(), text);
+    ASSERT_EQ(model.get_text(), long_text.substr(1));
+    ASSERT_EQ(model.get_children().size(), 3u);
+    ASSERT_EQ(model.get_children()[0].get(), child);
+    ASSERT_EQ(model.get_children()[2]->get_name(), "e");
+    ASSERT_EQ(model.get_items().size(), 2u);
+    ASSERT_EQ(model.get_items()["x"].get(), item);
+    ASSERT_EQ(model.get_items()["x"]->get_name(), "x2");
+    // Node of removed item is reused for new one
+    ASSERT_EQ(model.get_items().count("y"), 0u);
+    ASSERT_EQ(model.get_items()["z"].get(), stale_item);
+    ASSERT_EQ(model.get_items()["z"]->get_name(), "z");
+    ASSERT_EQ(&model.get_counts()["p"], counts);
+    ASSERT_EQ(model.get_counts()["p"], std::vector<int>({3}));
+    ASSERT_EQ(model.get_optional().value().get(), optional);
+    ASSERT_EQ(model.get_optional().value()->get_name(), "o2");
+    ASSERT_EQ(std::get<2>(model.get_variant()).get(), variant);
+    ASSERT_EQ(std::get<2>(model.get_variant())->get_name(), "v2");
+
+    ASSERT_TRUE(model.from_json(R"({"text":"","children":[],"items":{},"counts":{},"variant":"s"})"));
+    ASSERT_TRUE(model.get_children().empty());
+    ASSERT_TRUE(model.get_items().empty());
+    ASSERT_TRUE(model.get_counts().empty());
+    ASSERT_FALSE(model.get_optional().has_value());
+    ASSERT_EQ(std::get<1>(model.get_variant()), "s");
+    ASSERT_TRUE(model.from_json(R"({"text":"","children":[],"items":{},"counts":{},"variant":1})"));
+    ASSERT_EQ(std::get<0>(model.get_variant()), 1);
+}
+
+} // namespace reuse
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace sequences {
+
+struct Point : public json_model::Model {
+    DECLARE_FIELD(coordinates, std::array<double, 2>);
+
+    PROVIDE_DETAILS(
+        Point,
+        coordinates(_, "coordinates")
+    )
+};
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(color, std::array<int, 3>);
+    DECLARE_FIELD(points, std::array<std::unique_ptr<Point>, 2>);
+    DECLARE_FIELD(tags, json_model::SmallVector<std::string, 2>);
+    DECLARE_FIELD(lines, std::vector<json_model::SmallVector<std::array<int, 2>, 4>>);
+
+    PROVIDE_DETAILS(
+        Model,
+        color(_, "color"),
+        points(_, "points"),
+        tags(_, "tags"),
+        lines(_, "lines")
+    )
+};
+
+TEST(from_json, sequences) {
+    Model model;
+    ASSERT_EQ(model.to_json(), R"({"color":[0,0,0],"points":[{"coordinates":[0.0,0.0]},{"coordinates":[0.0,0.0]}],)"
+                               R"("tags":[],"lines":[]})");
+
+    const std::string json = R"({"color":[1,2,3],"points":[{"coordinates":[1.5,2.0]},{"coordinates":[3.0,4.5]}],)"
+                             R"("tags":["a","b","c"],"lines":[[[1,2],[3,4]],[]]})";
+    ASSERT_TRUE(model.from_json(json));
+    ASSERT_EQ(model.to_json(), json);
+    ASSERT_GE(model.json_size(), json.size());
+    ASSERT_EQ(model.get_color(), (std::array<int, 3>{1, 2, 3}));
+    ASSERT_EQ(model.get_tags().size(), 3u);
+    ASSERT_FALSE(model.get_tags().is_inline());
+    ASSERT_TRUE(model.get_lines()[0].is_inline());
+
+    Model other;
+    ASSERT_TRUE(other.from_msgpack(model.to_msgpack()));
+    ASSERT_EQ(json_model::diff(model, other), "{}");
+
+    try {
+        model.from_json(R"({"color":[1,2,3],"points":[{"coordinates":[1.0,2.0,3.0]},{"coordinates":[1.0,2.0]}],)"
+                        R"("tags":[],"lines":[]})");
+        FAIL() << "Expected exception";
+    } catch (json_model::SizeMismatchError& error) {
+        ASSERT_EQ(error.get_compact(), R"(Size mismatch at 'root["points"][0]["coordinates"]' (expected: 2, actual: 3))");
+    }
+    ASSERT_FALSE(model.from_json(R"({"color":[1,2],"points":[{"coordinates":[1.0,2.0]},{"coordinates":[1.0,2.0]}],)"
+                                 R"("tags":[],"lines":[]})", false));
+}
+
+TEST(from_json, small_vector) {
+    json_model::SmallVector<std::unique_ptr<int>, 2> vector;
+    vector.push_back(std::make_unique<int>(1));
+    vector.emplace_back(std::make_unique<int>(2));
+    ASSERT_TRUE(vector.is_inline());
+    vector.push_back(std::make_unique<int>(3));
+    ASSERT_FALSE(vector.is_inline());
+    ASSERT_EQ(*vector.back(), 3);
+
+    auto moved = std::move(vector);
+    ASSERT_TRUE(vector.empty());
+    ASSERT_EQ(moved.size(), 3u);
+    moved.resize(1);
+    ASSERT_EQ(*moved[0], 1);
+    ASSERT_GE(moved.capacity(), 3u);
+    moved.clear();
+    ASSERT_TRUE(moved.empty());
+
+    json_model::SmallVector<std::string, 2> strings{"a", "b"};
+    strings.push_back(strings[0]);
+    json_model::SmallVector<std::string, 2> copy;
+    copy = strings;
+    ASSERT_EQ(copy, strings);
+    ASSERT_EQ(copy[2], "a");
+    copy = json_model::SmallVector<std::string, 2>{"c"};
+    ASSERT_TRUE(copy.is_inline());
+    ASSERT_NE(copy, strings);
+}
+
+} // namespace sequences
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace enums {
+
+enum class Side : uint8_t {
+    BUY,
+    SELL,
+};
+
+JSON_MODEL_ENUM(Side, "buy", "sell");
+
+enum class Status {
+    NEW,
+    PARTIALLY_FILLED,
+    FILLED,
+    CANCELED,
+    QUOTED,
+};
+
+JSON_MODEL_ENUM(Status, "new", "partially_filled", "filled", "canceled", "with \"quotes\"");
+
+// Two-letter codes, e.g. of countries, which are too many for a single hash seed
+enum class Code : uint16_t {};
+
+JSON_MODEL_ENUM(
+    Code,
+    "aa", "ab", "ac", "ad", "ae", "af", "ag", "ah", "ai", "aj", "ak", "al", "am", "an", "ao", "ap", "aq", "ar", "as", "at",
+    "au", "av", "aw", "ax", "ay", "az", "ba", "bb", "bc", "bd", "be", "bf", "bg", "bh", "bi", "bj", "bk", "bl", "bm", "bn",
+    "bo", "bp", "bq", "br", "bs", "bt", "bu", "bv", "bw", "bx", "by", "bz", "ca", "cb", "cc", "cd", "ce", "cf", "cg", "ch",
+    "ci", "cj", "ck", "cl", "cm", "cn", "co", "cp", "cq", "cr", "cs", "ct", "cu", "cv", "cw", "cx", "cy", "cz", "da", "db",
+    "dc", "dd", "de", "df", "dg", "dh", "di", "dj", "dk", "dl", "dm", "dn", "do", "dp", "dq", "dr", "ds", "dt", "du", "dv",
+    "dw", "dx", "dy", "dz", "ea", "eb", "ec", "ed", "ee", "ef", "eg", "eh", "ei", "ej", "ek", "el", "em", "en", "eo", "ep",
+    "eq", "er", "es", "et", "eu", "ev", "ew", "ex", "ey", "ez", "fa", "fb", "fc", "fd", "fe", "ff", "fg", "fh", "fi", "fj",
+    "fk", "fl", "fm", "fn", "fo", "fp", "fq", "fr", "fs", "ft", "fu", "fv", "fw", "fx", "fy", "fz", "ga", "gb", "gc", "gd",
+    "ge", "gf", "gg", "gh", "gi", "gj", "gk", "gl", "gm", "gn", "go", "gp", "gq", "gr", "gs", "gt", "gu", "gv", "gw", "gx",
+    "gy", "gz", "ha", "hb", "hc", "hd", "he", "hf", "hg", "hh", "hi", "hj", "hk", "hl", "hm", "hn", "ho", "hp", "hq", "hr",
+    "hs", "ht", "hu", "hv", "hw", "hx", "hy", "hz", "ia", "ib", "ic", "id", "ie", "if", "ig", "ih", "ii", "ij", "ik", "il",
+    "im", "in", "io", "ip", "iq", "ir", "is", "it", "iu", "iv", "iw", "ix", "iy", "iz", "ja", "jb", "jc", "jd", "je", "jf",
+    "jg", "jh", "ji", "jj", "jk", "jl", "jm", "jn", "jo", "jp", "jq", "jr", "js", "jt", "ju", "jv", "jw", "jx", "jy", "jz",
+    "ka", "kb", "kc", "kd", "ke", "kf", "kg", "kh", "ki", "kj", "kk", "kl", "km", "kn", "ko", "kp", "kq", "kr", "ks", "kt",
+    "ku", "kv", "kw", "kx", "ky", "kz", "la", "lb", "lc", "ld", "le", "lf", "lg", "lh", "li", "lj", "lk", "ll", "lm", "ln"
+);
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(side, Side);
+    DECLARE_FIELD(history, std::vector<Status>);
+    DECLARE_FIELD(variant, std::variant<Side, int>);
+    DECLARE_FIELD(optional, std::optional<Status>);
+
+    PROVIDE_DETAILS(
+        Model,
+        side(_, "side"),
+        history(_, "history"),
+        variant(_, "variant"),
+        optional(_, "optional")
+    )
+};
+
+TEST(from_json, enums) {
+    static_assert(json_model::is_enum_v<Side>);
+    static_assert(sizeof(Side) == 1);
+
+    Model model;
+    ASSERT_EQ(model.to_json(), R"({"side":"buy","history":[],"variant":"buy"})");
+
+    const std::string json = R"({"side":"sell","history":["new","partially_filled","with \"quotes\"","canceled"],)"
+                             R"("variant":5,"optional":"filled"})";
+    ASSERT_TRUE(model.from_json(json));
+    ASSERT_EQ(model.get_side(), Side::SELL);
+    ASSERT_EQ(model.get_history()[2], Status::QUOTED);
+    ASSERT_EQ(std::get<1>(model.get_variant()), 5);
+    ASSERT_EQ(model.get_optional(), Status::FILLED);
+    ASSERT_EQ(model.to_json(), json);
+    ASSERT_EQ(model.json_size(), json.size());
+
+    Model other;
+    ASSERT_TRUE(other.from_cbor(model.to_cbor()));
+    ASSERT_EQ(other.to_json(), json);
+    other.set_side(Side::BUY);
+    ASSERT_EQ(json_model::diff(model, other), R"({"side":"buy"})");
+
+    try {
+        model.from_json(R"({"side":"hold","history":[]})");
+        FAIL() << "Expected exception";
+    } catch (json_model::TypeMismatchError& error) {
+        ASSERT_EQ(error.get_compact(), R"(Type mismatch at 'root["side"]' (expected: "buy"|"sell", actual: "hold"))");
+    }
+    ASSERT_THROW(model.from_json(R"({"side":1,"history":[]})"), json_model::TypeMismatchError);
+    ASSERT_FALSE(model.from_json(R"({"side":"sell","history":["filed"]})", false));
+
+    // Values out of range are written as empty string, which is not parsed back
+    model.set_side(static_cast<Side>(7));
+    model.get_history().clear();
+    const std::string invalid_json = R"({"side":"","history":[],"variant":5,"optional":"filled"})";
+    ASSERT_EQ(model.to_json(), invalid_json);
+    ASSERT_EQ(model.json_size(), invalid_json.size());
+    ASSERT_FALSE(other.from_msgpack(model.to_msgpack(), false));
+
+    for (size_t i = 0; i < json_model::EnumTable<Code>::SIZE; ++i) {
+        Code code{};
+        ASSERT_TRUE(json_model::EnumTable<Code>::find(json_model::EnumTable<Code>::NAMES[i], code));
+        ASSERT_EQ(static_cast<size_t>(code), i);
+    }
+    Code code{};
+    ASSERT_FALSE(json_model::EnumTable<Code>::find("zz", code));
+    ASSERT_FALSE(json_model::EnumTable<Code>::find("", code));
+    ASSERT_EQ(json_model::EnumTable<Code>::get_name(static_cast<Code>(300)), "");
+}
+
+} // namespace enums
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace bytes {
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(data, json_model::Bytes);
+    DECLARE_FIELD(chunks, std::vector<json_model::Bytes>);
+    DECLARE_FIELD(optional, std::optional<json_model::Bytes>);
+
+    PROVIDE_DETAILS(
+        Model,
+        data(_, "data"),
+        chunks(_, "chunks"),
+        optional(_, "optional")
+    )
+};
+
+std::string encode(const json_model::Bytes& bytes) {
+    std::string result(json_model::base64_encoded_size(bytes.size()), '\0');
+    json_model::base64_encode_scalar(bytes.data(), bytes.data() + bytes.size(), result.data());
+    return result;
+}
+
+TEST(from_json, bytes) {
+    static_assert(json_model::is_primitive_v<json_model::Bytes>);
+
+    Model model;
+    ASSERT_EQ(model.to_json(), R"({"data":"","chunks":[]})");
+
+    const std::string json = R"({"data":"Zm9vYmFy","chunks":["","Zg==","Zm8=","Zm9v","+/+/"],"optional":"AAECAw=="})";
+    ASSERT_TRUE(model.from_json(json));
+    ASSERT_EQ(model.get_data(), json_model::Bytes({'f', 'o', 'o', 'b', 'a', 'r'}));
+    ASSERT_EQ(model.get_chunks()[2], json_model::Bytes({'f', 'o'}));
+    ASSERT_EQ(model.get_chunks()[4], json_model::Bytes({0xFB, 0xFF, 0xBF}));
+    ASSERT_EQ(model.get_optional(), json_model::Bytes({0, 1, 2, 3}));
+    ASSERT_EQ(model.to_json(), json);
+    ASSERT_EQ(model.json_size(), json.size());
+
+    Model other;
+    ASSERT_TRUE(other.from_msgpack(model.to_msgpack()));
+    ASSERT_EQ(other.to_json(), json);
+    other.get_data().pop_back();
+    ASSERT_EQ(json_model::diff(model, other), R"({"data":"Zm9vYmE="})");
+
+    const std::string snapshot = model.to_snapshot();
+    auto view = json_model::open_snapshot<Model>(snapshot.data(), snapshot.size());
+    ASSERT_EQ(view.get<json_model::Bytes>("data"), "foobar");
+
+    try {
+        model.from_json(R"({"data":"Zm9v!mFy","chunks":[]})");
+        FAIL() << "Expected exception";
+    } catch (json_model::TypeMismatchError& error) {
+        ASSERT_EQ(error.get_compact(), R"(Type mismatch at 'root["data"]' (expected: base64, actual: invalid base64 string))");
+    }
+    ASSERT_THROW(model.from_json(R"({"data":[],"chunks":[]})"), json_model::TypeMismatchError);
+    ASSERT_FALSE(model.from_json(R"({"data":"Zm9","chunks":[]})", false));
+    ASSERT_FALSE(model.from_json(R"({"data":"Zm=v","chunks":[]})", false));
+    ASSERT_FALSE(model.from_json(R"({"data":"====","chunks":[]})", false));
+}
+
+// Vectorized codec must agree with scalar one on all lengths and byte values
+TEST(from_json, bytes_codec) {
+    json_model::Bytes bytes;
+    for (size_t size = 0; size < 200; ++size) {
+        bytes.push_back(static_cast<uint8_t>(size * 37 + 11));
+        const std::string encoded = encode(bytes);
+
+        Model model;
+        model.set_data(bytes);
+        ASSERT_EQ(model.to_json(), R"({"data":")" + encoded + R"(","chunks":[]})");
+
+        json_model::Bytes decoded;
+        ASSERT_TRUE(json_model::base64_decode(encoded.data(), encoded.size(), decoded));
+        ASSERT_EQ(decoded, bytes);
+
+        // Invalid character at any position is detected
+        for (size_t i = 0; i < encoded.size(); i += 7) {
+            std::string invalid = encoded;
+            invalid[i] = '-';
+            ASSERT_FALSE(json_model::base64_decode(invalid.data(), invalid.size(), decoded));
+        }
+    }
+
+    // Longer than one chunk of writer
+    Model model;
+    model.get_data().assign(10000, 0xAB);
+    ASSERT_EQ(model.to_json(), R"({"data":")" + encode(model.get_data()) + R"(","chunks":[]})");
+}
+
+} // namespace bytes
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace raw_numbers {
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(amount, json_model::RawNumber);
+    DECLARE_FIELD(ids, std::vector<json_model::RawNumber>);
+    DECLARE_FIELD(variant, std::variant<json_model::RawNumber, std::string>);
+    DECLARE_FIELD(ratio, std::optional<double>);
+
+    PROVIDE_DETAILS(
+        Model,
+        amount(_, "amount"),
+        ids(_, "ids"),
+        variant(_, "variant"),
+        ratio(_, "ratio")
+    )
+};
+
+struct Plain : public json_model::Model {
+    DECLARE_FIELD(ratio, double);
+
+    PROVIDE_DETAILS(
+        Plain,
+        ratio(_, "ratio")
+    )
+};
+
+TEST(from_json, raw_numbers) {
+    static_assert(json_model::is_primitive_v<json_model::RawNumber>);
+
+    Model model;
+    ASSERT_EQ(model.to_json(), R"({"amount":0,"ids":[],"variant":0})");
+
+    // Text of numbers is kept as is, including trailing zeros, exponents and integers longer than 64 bits
+    ASSERT_TRUE(model.from_json(R"( { "amount" : 12.3400 , "ids": [340282366920938463463374607431768211455,-0,)"
+                                R"(1.5E+3, 7], "variant":1e-2})"));
+    const std::string json = R"({"amount":12.3400,"ids":[340282366920938463463374607431768211455,-0,1.5E+3,7],)"
+                             R"("variant":1e-2})";
+    ASSERT_EQ(model.to_json(), json);
+    ASSERT_EQ(model.json_size(), json.size());
+    ASSERT_EQ(model.get_amount().get_text(), "12.3400");
+
+    ASSERT_TRUE(model.from_json(R"({"amount":1,"ids":[],"variant":"1"})"));
+    ASSERT_EQ(std::get<std::string>(model.get_variant()), "1");
+    ASSERT_TRUE(json_model::apply_patch(model, R"({"amount":1.10,"variant":-2.50})"));
+    ASSERT_EQ(model.to_json(), R"({"amount":1.10,"ids":[],"variant":-2.50})");
+
+    // Binary formats don't keep text of decimals
+    model.get_ids().emplace_back("18446744073709551615");
+    Model other;
+    ASSERT_TRUE(other.from_cbor(model.to_cbor()));
+    ASSERT_EQ(other.to_json(), R"({"amount":1.1,"ids":[18446744073709551615],"variant":-2.5})");
+
+    try {
+        model.from_json(R"({"amount":"12","ids":[],"variant":1})");
+        FAIL() << "Expected exception";
+    } catch (json_model::TypeMismatchError& error) {
+        ASSERT_EQ(error.get_compact(), R"(Type mismatch at 'root["amount"]' (expected: number, actual: string))");
+    }
+}
+
+TEST(from_json, raw_numbers_out_of_double_range) {
+    ASSERT_FALSE(json_model::get_source_schema<Model>().is_plain());
+    ASSERT_TRUE(json_model::get_source_schema<Plain>().is_plain());
+
+    // Raw numbers are never converted, so they may not fit double
+    const std::string integer = "-" + std::string(330, '7');
+    Model model;
+    const std::string json = R"({"amount":1e400,"ids":[)" + integer + R"(,1E-400],"variant":)" + integer + "}";
+    ASSERT_TRUE(model.from_json(json));
+    ASSERT_EQ(model.get_amount().get_text(), "1e400");
+    ASSERT_EQ(model.get_ids()[0].get_text(), integer);
+    ASSERT_EQ(std::get<json_model::RawNumber>(model.get_variant()).get_text(), integer);
+    ASSERT_EQ(model.to_json(), json);
+    ASSERT_TRUE(json_model::apply_patch(model, R"({"amount":-2e400,"variant":"1e400"})"));
+    ASSERT_EQ(model.get_amount().get_text(), "-2e400");
+    ASSERT_EQ(std::get<std::string>(model.get_variant()), "1e400");
+
+    // Other numbers are converted as usual
+    ASSERT_TRUE(model.from_json(R"({"amount":1,"ids":[],"variant":2,"ratio":0.25})"));
+    ASSERT_EQ(model.get_ratio(), 0.25);
+    Plain plain;
+    for (json_model::Model* target : std::initializer_list<json_model::Model*>{&model, &plain}) {
+        try {
+            target->from_json(R"({"amount":1,"ids":[],"variant":2,"ratio":1e400})");
+            FAIL() << "Expected exception";
+        } catch (json_model::ParseError& error) {
+            ASSERT_EQ(error.get_compact(), "Cannot parse json (offset 41): Number too big to be stored in double.");
+        }
+    }
+}
+
+TEST(from_json, raw_number_accessors) {
+    int64_t fixed;
+    ASSERT_TRUE(json_model::RawNumber("12.3400").to_fixed(2, fixed));
+    ASSERT_EQ(fixed, 1234);
+    ASSERT_FALSE(json_model::RawNumber("12.3400").to_fixed(1, fixed));
+    ASSERT_TRUE(json_model::RawNumber("1.5E+3").to_fixed(0, fixed));
+    ASSERT_EQ(fixed, 1500);
+    ASSERT_TRUE(json_model::RawNumber("-5e-2").to_fixed(4, fixed));
+    ASSERT_EQ(fixed, -500);
+    ASSERT_TRUE(json_model::RawNumber("-9223372036854775808").to_fixed(0, fixed));
+    ASSERT_EQ(fixed, INT64_MIN);
+    ASSERT_FALSE(json_model::RawNumber("9223372036854775808").to_fixed(0, fixed));
+    ASSERT_FALSE(json_model::RawNumber("92233720368547758.07").to_fixed(3, fixed));
+    ASSERT_TRUE(json_model::RawNumber("0e999999").to_fixed(2, fixed));
+    ASSERT_EQ(fixed, 0);
+
+    ASSERT_EQ(json_model::RawNumber::from_fixed(1234, 2).get_text(), "12.34");
+    ASSERT_EQ(json_model::RawNumber::from_fixed(-5, 2).get_text(), "-0.05");
+    ASSERT_EQ(json_model::RawNumber::from_fixed(INT64_MIN, 0).get_text(), "-9223372036854775808");
+
+    int64_t int_value;
+    uint64_t uint_value;
+    ASSERT_TRUE(json_model::RawNumber("-42").to_int64(int_value));
+    ASSERT_EQ(int_value, -42);
+    ASSERT_FALSE(json_model::RawNumber("-42").to_uint64(uint_value));
+    ASSERT_FALSE(json_model::RawNumber("4.2").to_int64(int_value));
+    ASSERT_FALSE(json_model::RawNumber("18446744073709551616").to_uint64(uint_value));
+    ASSERT_EQ(json_model::RawNumber("2.5e-1").to_double(), 0.25);
+}
+
+} // namespace raw_numbers
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace raw_json {
+
+struct Envelope : public json_model::Model {
+    DECLARE_FIELD(type, std::string);
+    DECLARE_FIELD(payload, json_model::RawJson);
+    DECLARE_FIELD(extra, std::optional<json_model::RawJson>);
+
+    PROVIDE_DETAILS(
+        Envelope,
+        type(_, "type"),
+        payload(_, "payload"),
+        extra(_, "extra")
+    )
+};
+
+TEST(from_json, raw_json) {
+    static_assert(json_model::is_primitive_v<json_model::RawJson>);
+
+    Envelope model;
+    ASSERT_EQ(model.to_json(), R"({"type":"","payload":null})");
+
+    // Payload is kept byte by byte, including formatting and escapes
+    const std::string payload = R"({ "b": [1, 2.50, {"c": "\u0041\n"}], "a": null })";
+    ASSERT_TRUE(model.from_json(R"({"type":"event","payload": )" + payload + R"( ,"extra":"\"quoted\""})"));
+    ASSERT_EQ(model.get_payload().get_text(), payload);
+    ASSERT_EQ(model.get_extra()->get_text(), R"("\"quoted\"")");
+    const std::string json = R"({"type":"event","payload":)" + payload + R"(,"extra":"\"quoted\""})";
+    ASSERT_EQ(model.to_json(), json);
+    ASSERT_EQ(model.json_size(), json.size());
+
+    // Payload isn't built as values, so numbers in it are never converted
+    const std::string numbers = R"([1e400, -)" + std::string(400, '9') + R"(, {"a": [1E+999]}])";
+    ASSERT_TRUE(model.from_json(R"({"type":"","payload":)" + numbers + R"(,"extra":-1e-999})"));
+    ASSERT_EQ(model.get_payload().get_text(), numbers);
+    ASSERT_EQ(model.get_extra()->get_text(), "-1e-999");
+    ASSERT_THROW(model.from_json(R"({"type":"","payload":[1,}]})"), json_model::ParseError);
+
+    for (const std::string value : {"1e5", "true", "false", "[]", "\"\"", "{}"}) {
+        ASSERT_TRUE(model.from_json(R"({"type":"","payload":)" + value + "}"));
+        ASSERT_EQ(model.get_payload().get_text(), value);
+        ASSERT_FALSE(model.get_extra().has_value());
+        ASSERT_EQ(model.to_json(), R"({"type":"","payload":)" + value + "}");
+    }
+
+    // Binary formats write payload as value, and it is read back in compact form
+    model.get_payload().set_text(payload);
+    Envelope other;
+    ASSERT_TRUE(other.from_msgpack(model.to_msgpack()));
+    ASSERT_EQ(other.get_payload().get_text(), R"({"b":[1,2.5,{"c":"A\n"}],"a":null})");
+
+    // Object payloads are merged by patches
+    other.get_payload().set_text(R"({"a":1,"b":[1]})");
+    ASSERT_EQ(json_model::diff(model, other), R"({"payload":{"a":1,"b":[1]}})");
+    ASSERT_TRUE(json_model::apply_patch(model, R"({"payload":{"b":null,"c":{"d":true}}})"));
+    ASSERT_EQ(model.get_payload().get_text(), R"({"a":null,"c":{"d":true}})");
+
+    // Other payloads are replaced with their text
+    ASSERT_TRUE(json_model::apply_patch(model, R"({"payload":[1e400],"extra":2E+999})"));
+    ASSERT_EQ(model.get_payload().get_text(), "[1e400]");
+    ASSERT_EQ(model.get_extra()->get_text(), "2E+999");
+}
+
+} // namespace raw_json
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace dynamic_values {
+
+struct Event : public json_model::Model {
+    DECLARE_FIELD(name, std::string);
+    DECLARE_FIELD(attributes, json_model::Value);
+    DECLARE_FIELD(source, json_model::RawJson);
+    DECLARE_FIELD(tag, std::variant<int, json_model::Value>);
+
+    PROVIDE_DETAILS(
+        Event,
+        name(_, "name"),
+        attributes(_, "attributes"),
+        source(_, "source"),
+        tag(_, "tag")
+    )
+};
+
+TEST(from_json, dynamic_values) {
+    static_assert(json_model::is_primitive_v<json_model::Value>);
+
+    Event model;
+    ASSERT_EQ(model.to_json(), R"({"name":"","attributes":null,"source":null,"tag":0})");
+
+    // Raw fields after moved values still find their source text
+    const std::string json =
+        R"({"name":"click","attributes":{"x":10,"y":-2.5,"path":["a","b\n"],"ok":true},"source":{ "id" : 7 },"tag":{"k":[]}})";
+    ASSERT_TRUE(model.from_json(json));
+    const auto& attributes = model.get_attributes().get_value();
+    ASSERT_TRUE(attributes.IsObject());
+    ASSERT_EQ(attributes["x"].GetInt(), 10);
+    ASSERT_EQ(attributes["path"][1].GetString(), std::string("b\n"));
+    ASSERT_EQ(model.get_source().get_text(), R"({ "id" : 7 })");
+    ASSERT_TRUE(std::get<1>(model.get_tag()).get_value().IsObject());
+    ASSERT_EQ(model.to_json(), R"({"name":"click","attributes":{"x":10,"y":-2.5,"path":["a","b\n"],"ok":true},)"
+                               R"("source":{ "id" : 7 },"tag":{"k":[]}})");
+    ASSERT_GE(model.json_size(), model.to_json().size());
+
+    // Copies don't share allocator, so they can be modified independently
+    json_model::Value copy = model.get_attributes();
+    copy.get_value()["x"].SetInt(11);
+    ASSERT_EQ(attributes["x"].GetInt(), 10);
+    ASSERT_NE(copy, model.get_attributes());
+    copy.get_value().AddMember("z", json_model::json_value_t("added", copy.get_allocator()), copy.get_allocator());
+    ASSERT_EQ(copy.get_value()["z"].GetString(), std::string("added"));
+
+    // Values outlive the model they were parsed into
+    json_model::Value moved;
+    {
+        Event temporary;
+        ASSERT_TRUE(temporary.from_json(json));
+        moved = std::move(temporary.get_attributes());
+    }
+    ASSERT_EQ(moved, model.get_attributes());
+
+    Event other;
+    ASSERT_TRUE(other.from_msgpack(model.to_msgpack()));
+    ASSERT_EQ(other.get_attributes(), model.get_attributes());
+    ASSERT_EQ(other.get_tag(), model.get_tag());
+    ASSERT_TRUE(other.from_cbor(model.to_cbor()));
+    ASSERT_EQ(other.get_attributes(), model.get_attributes());
+
+    other.set_source(model.get_source());
+    ASSERT_TRUE(json_model::apply_patch(other, R"({"attributes":{"x":null,"path":"p"}})"));
+    ASSERT_EQ(json_model::diff(model, other), R"({"attributes":{"x":null,"path":"p"}})");
+    ASSERT_EQ(other.to_json(), R"({"name":"click","attributes":{"y":-2.5,"path":"p","ok":true},)"
+                               R"("source":{ "id" : 7 },"tag":{"k":[]}})");
+
+    auto snapshot = model.to_snapshot();
+    auto view = json_model::open_snapshot<Event>(snapshot.data(), snapshot.size());
+    ASSERT_EQ(view.get<json_model::Value>("attributes"), R"({"x":10,"y":-2.5,"path":["a","b\n"],"ok":true})");
+
+    ASSERT_TRUE(model.from_json(R"({"name":"","attributes":[1,"two"],"source":3,"tag":5})"));
+    ASSERT_TRUE(model.get_attributes().get_value().IsArray());
+    ASSERT_EQ(std::get<0>(model.get_tag()), 5);
+}
+
+} // namespace dynamic_values
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace push_parser {
+
+struct Item : public json_model::Model {
+    DECLARE_FIELD(id, int64_t);
+    DECLARE_FIELD(ok, bool);
+
+    PROVIDE_DETAILS(
+        Item,
+        id(_, "id"),
+        ok(_, "ok")
+    )
+};
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(name, std::string);
+    DECLARE_FIELD(price, double);
+    DECLARE_FIELD(items, std::vector<std::unique_ptr<Item>>);
+    DECLARE_FIELD(counts, std::map<std::string, int>);
+    DECLARE_FIELD(note, std::optional<std::string>);
+    DECLARE_FIELD(attributes, json_model::Value);
+
+    PROVIDE_DETAILS(
+        Model,
+        name(_, "name"),
+        price(_, "price"),
+        items(_, "items"),
+        counts(_, "counts"),
+        note(_, "note"),
+        attributes(_, "attributes")
+    )
+};
+
+bool parse_in_chunks(Model& model, const std::string& json, size_t chunk_size, bool throw_on_error = true) {
+    json_model::PushParser parser(model, throw_on_error);
+    for (size_t i = 0; i < json.size(); i += chunk_size) {
+        if (!parser.feed(json.data() + i, std::min(chunk_size, json.size() - i))) {
+            return false;
+        }
+    }
+    return parser.finish();
+}
+
+TEST(from_json, push_parser) {
+    const std::string json = " {\"name\" : \"a \\\"quoted\\\" \\\\ name\",\"price\":-12.5e-1, \"items\":[{\"id\":123456789012,"
+                             "\"ok\":true},{\"id\":-7,\"ok\":false}],\n\"counts\":{\"a\":1,\"b\":22},\"note\":\"\",\t"
+                             "\"attributes\":[null,1,\"\\u0041\",[],{}]}\r\n";
+    Model expected;
+    ASSERT_TRUE(expected.from_json(json));
+
+    // Tokens are split at every possible position
+    for (size_t chunk_size = 1; chunk_size <= json.size(); ++chunk_size) {
+        Model model;
+        ASSERT_TRUE(parse_in_chunks(model, json, chunk_size)) << chunk_size;
+        ASSERT_EQ(model.to_json(), expected.to_json()) << chunk_size;
+    }
+
+    // Empty chunks are allowed, and model isn't touched before finish()
+    Model model;
+    json_model::PushParser parser(model);
+    ASSERT_TRUE(parser.feed(json.substr(0, 40)));
+    ASSERT_TRUE(parser.feed(""));
+    ASSERT_TRUE(model.get_name().empty());
+    ASSERT_TRUE(parser.feed(json.substr(40)));
+    ASSERT_TRUE(parser.finish());
+    ASSERT_EQ(model.to_json(), expected.to_json());
+    ASSERT_FALSE(parser.finish());
+}
+
+TEST(from_json, push_parser_errors) {
+    const std::string valid = R"({"name":"","price":1,"items":[],"counts":{},"attributes":null})";
+    for (size_t chunk_size : {1u, 3u, 100u}) {
+        Model model;
+        try {
+            JSON_MODEL_THROWS_(json_model::ParseError, parse_in_chunks(model, R"({"name":"",  "price":})", chunk_size));
+        } catch (json_model::Exception& error) {
+            ASSERT_EQ(error.get_compact(), "Cannot parse json (offset 21): Invalid value.");
+        }
+        try {
+            JSON_MODEL_THROWS_(json_model::ParseError, parse_in_chunks(model, valid + " {}", chunk_size));
+        } catch (json_model::Exception& error) {
+            ASSERT_EQ(error.get_compact(), "Cannot parse json (offset 63): The document root must not be followed by "
+                                           "other values.");
+        }
+        try {
+            JSON_MODEL_THROWS_(json_model::ParseError, parse_in_chunks(model, R"({"name":"", "price":12)", chunk_size));
+        } catch (json_model::Exception& error) {
+            ASSERT_EQ(error.get_compact(), "Cannot parse json (offset 22): Missing a comma or '}' after an object member.");
+        }
+        ASSERT_THROW(parse_in_chunks(model, "  ", chunk_size), json_model::ParseError);
+        ASSERT_THROW(parse_in_chunks(model, R"({"name":1})", chunk_size), json_model::TypeMismatchError);
+        ASSERT_FALSE(parse_in_chunks(model, R"({"name":"x")", chunk_size, false));
+        ASSERT_FALSE(parse_in_chunks(model, R"({"name":"x"})", chunk_size, false));
+        ASSERT_TRUE(parse_in_chunks(model, valid, chunk_size, false));
+    }
+}
+
+struct Payment : public json_model::Model {
+    DECLARE_FIELD(amount, json_model::RawNumber);
+
+    PROVIDE_DETAILS(
+        Payment,
+        amount(_, "amount")
+    )
+};
+
+TEST(from_json, push_parser_raw_numbers) {
+    // Numbers are converted while tokens are read, as source isn't kept, so raw numbers lose their text
+    Payment payment;
+    json_model::PushParser parser(payment);
+    ASSERT_TRUE(parser.feed(R"({"amount":12345678901234567890123.10})"));
+    ASSERT_TRUE(parser.finish());
+    ASSERT_EQ(payment.get_amount().get_text(), "1.2345678901234568e+22");
+    ASSERT_TRUE(payment.from_json(R"({"amount":12345678901234567890123.10})"));
+    ASSERT_EQ(payment.get_amount().get_text(), "12345678901234567890123.10");
+
+    json_model::PushParser out_of_range(payment);
+    try {
+        JSON_MODEL_THROWS_(json_model::ParseError, out_of_range.feed(R"({"amount":1e400})"));
+    } catch (json_model::Exception& error) {
+        ASSERT_EQ(error.get_compact(), "Cannot parse json (offset 10): Number too big to be stored in double.");
+    }
+    ASSERT_TRUE(payment.from_json(R"({"amount":1e400})"));
+}
+
+} // namespace push_parser
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // namespace json_model::test_from_json
@@ -0,0 +1,161 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#include <json_model/model.h>
+
+#include <gtest/gtest.h>
+#include <string>
+
+namespace json_model::test_patch {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace diff {
+
+struct Nested : public json_model::Model {
+    DECLARE_FIELD(id, int);
+    DECLARE_FIELD(note, std::optional<std::string>);
+
+    PROVIDE_DETAILS(
+        Nested,
+        id(_, "id"),
+        note(_, "note")
+    )
+};
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(name, std::string);
+    DECLARE_FIELD(price, double);
+    DECLARE_FIELD(tags, std::vector<std::string>);
+    DECLARE_FIELD(counts, std::map<std::string, int>);
+    DECLARE_FIELD(nested, std::unique_ptr<Nested>);
+    DECLARE_FIELD(items, std::map<std::string, std::unique_ptr<Nested>>);
+    DECLARE_FIELD(variant, std::variant<int, std::map<std::string, int>>);
+    DECLARE_FIELD(optional, std::optional<int>);
+
+    PROVIDE_DETAILS(
+        Model,
+        name(_, "name"),
+        price(_, "price", json_model::max_decimal_places(2)),
+        tags(_, "tags"),
+        counts(_, "counts"),
+        nested(_, "nested"),
+        items(_, "items"),
+        variant(_, "variant"),
+        optional(_, "optional")
+    )
+};
+
+void fill(Model& model) {
+    model.set_name("name");
+    model.set_price(1.5);
+    model.set_tags(std::vector<std::string>{"a", "b"});
+    model.get_counts()["x"] = 1;
+    model.get_counts()["y"] = 2;
+    model.get_nested()->set_id(1);
+    model.get_items()["first"] = std::make_unique<Nested>();
+    model.get_items()["second"] = std::make_unique<Nested>();
+    model.set_optional(5);
+}
+
+TEST(patch, diff) {
+    Model source;
+    Model target;
+    fill(source);
+    fill(target);
+    ASSERT_EQ(json_model::diff(source, target), "{}");
+
+    target.set_price(2.126);
+    target.get_tags().push_back("c");
+    target.get_counts().erase("x");
+    target.get_counts()["y"] = 3;
+    target.get_counts()["z"] = 4;
+    target.get_nested()->set_note("note");
+    target.get_items()["first"]->set_id(7);
+    target.get_items().erase("second");
+    target.get_items()["third"] = std::make_unique<Nested>();
+    target.set_optional(std::nullopt);
+    ASSERT_EQ(
+        json_model::diff(source, target),
+        R"({"price":2.13,"tags":["a","b","c"],"counts":{"x":null,"y":3,"z":4},"nested":{"note":"note"},)"
+        R"("items":{"second":null,"first":{"id":7},"third":{"id":0}},"optional":null})"
+    );
+    ASSERT_EQ(json_model::diff(target, source).substr(0, 12), R"({"price":1.5)");
+
+    // Objects in variants are diffed recursively, other alternatives replace them
+    source.set_variant(std::map<std::string, int>{{"a", 1}, {"b", 2}});
+    Model other_target;
+    fill(other_target);
+    other_target.set_variant(std::map<std::string, int>{{"b", 3}});
+    ASSERT_EQ(json_model::diff(source, other_target), R"({"variant":{"a":null,"b":3}})");
+    other_target.set_variant(10);
+    ASSERT_EQ(json_model::diff(source, other_target), R"({"variant":10})");
+}
+
+TEST(patch, apply_patch) {
+    Model source;
+    Model target;
+    fill(source);
+    fill(target);
+    target.set_name("other");
+    target.get_tags().clear();
+    target.get_counts().erase("y");
+    target.get_counts()["w"] = 0;
+    target.get_nested()->set_note("note");
+    target.get_items()["first"]->set_id(3);
+    target.get_items()["third"] = std::make_unique<Nested>();
+    target.get_items()["third"]->set_note("third");
+    target.set_variant(std::map<std::string, int>{{"k", 1}});
+    target.set_optional(std::nullopt);
+
+    const Nested* nested = source.get_nested().get();
+    ASSERT_TRUE(json_model::apply_patch(source, json_model::diff(source, target)));
+    ASSERT_EQ(source.to_json(), target.to_json());
+    ASSERT_EQ(json_model::diff(source, target), "{}");
+    // Nested models are patched in place
+    ASSERT_EQ(source.get_nested().get(), nested);
+
+    source.set_variant(std::map<std::string, int>{{"k", 1}, {"l", 2}});
+    ASSERT_TRUE(json_model::apply_patch(source, R"({"variant":{"k":null,"m":3}})"));
+    ASSERT_EQ(std::get<1>(source.get_variant()), (std::map<std::string, int>{{"l", 2}, {"m", 3}}));
+
+    // Members missing in patch are not touched, unknown members are ignored
+    ASSERT_TRUE(json_model::apply_patch(source, R"({"unknown":1,"optional":8})"));
+    ASSERT_EQ(source.get_name(), "other");
+    ASSERT_EQ(source.get_optional(), 8);
+}
+
+TEST(patch, apply_patch_errors) {
+    Model model;
+    fill(model);
+
+    ASSERT_THROW(json_model::apply_patch(model, "{"), json_model::ParseError);
+    ASSERT_FALSE(json_model::apply_patch(model, "{", false));
+    ASSERT_THROW(json_model::apply_patch(model, "[]"), json_model::TypeMismatchError);
+
+    try {
+        json_model::apply_patch(model, R"({"items":{"first":{"id":"x"}}})");
+        FAIL() << "Expected exception";
+    } catch (json_model::TypeMismatchError& error) {
+        ASSERT_EQ(error.get_compact(), R"(Type mismatch at 'root["items"]["first"]["id"]' (expected: int, actual: string))");
+    }
+    ASSERT_FALSE(json_model::apply_patch(model, R"({"items":{"first":{"id":"x"}}})", false));
+
+    try {
+        json_model::apply_patch(model, R"({"nested":{"id":null}})");
+        FAIL() << "Expected exception";
+    } catch (json_model::MissingKeyError& error) {
+        ASSERT_EQ(error.get_compact(), R"(Key 'id' missing at 'root["nested"]')");
+    }
+    ASSERT_FALSE(json_model::apply_patch(model, R"({"nested":{"id":null}})", false));
+
+    // New map items are parsed as a whole
+    ASSERT_THROW(json_model::apply_patch(model, R"({"items":{"new":{}}})"), json_model::MissingKeyError);
+}
+
+} // namespace diff
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace json_model::test_patch
@@ -0,0 +1,260 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#include <json_model/atomic_model.h>
+#include <json_model/model.h>
+#include <json_model/pool.h>
+
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <thread>
+
+namespace json_model::test_pool {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace pool {
+
+struct Nested : public json_model::Model {
+    DECLARE_FIELD(id, int);
+    DECLARE_FIELD(values, std::vector<int>);
+
+    PROVIDE_DETAILS(
+        Nested,
+        id(_, "id"),
+        values(_, "values")
+    )
+};
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(name, std::string);
+    DECLARE_FIELD(price, double);
+    DECLARE_FIELD(tags, std::vector<std::string>);
+    DECLARE_FIELD(counts, std::map<std::string, int>);
+    DECLARE_FIELD(nested, std::unique_ptr<Nested>);
+    DECLARE_FIELD(variant, std::variant<int, std::string>);
+    DECLARE_FIELD(optional, std::optional<int>);
+
+    PROVIDE_DETAILS(
+        Model,
+        name(_, "name"),
+        price(_, "price"),
+        tags(_, "tags"),
+        counts(_, "counts"),
+        nested(_, "nested"),
+        variant(_, "variant"),
+        optional(_, "optional")
+    )
+};
+
+const std::string JSON = R"({"name":"a rather long name to be allocated on heap","price":1.5,"tags":["a","b"],)"
+                         R"("counts":{"x":1},"nested":{"id":2,"values":[1,2,3]},"variant":"text","optional":3})";
+
+TEST(pool, reset) {
+    json_model::Pool<Model> pool;
+    const Model* model_address;
+    const Nested* nested_address;
+    size_t name_capacity;
+    {
+        auto model = pool.acquire();
+        ASSERT_TRUE(model);
+        ASSERT_TRUE(model->from_json(JSON));
+        ASSERT_EQ(model->to_json(), JSON);
+        model_address = model.get();
+        nested_address = model->get_nested().get();
+        name_capacity = model->get_name().capacity();
+    }
+
+    // Released model is reused on the same thread, and looks like a new one
+    auto model = pool.acquire();
+    ASSERT_EQ(model.get(), model_address);
+    ASSERT_EQ(model->to_json(), Model().to_json());
+    ASSERT_EQ(model->get_nested().get(), nested_address);
+    ASSERT_EQ(model->get_name().capacity(), name_capacity);
+    ASSERT_GE(model->get_nested()->get_values().capacity(), 3u);
+
+    auto other = pool.acquire();
+    ASSERT_NE(other.get(), model.get());
+    model = std::move(other);
+    ASSERT_FALSE(other);
+    model.release();
+    ASSERT_EQ(model.get(), nullptr);
+
+    // Pools of the same model don't share free models, and free all of them when destroyed
+    auto other_pool = std::make_unique<json_model::Pool<Model>>();
+    const Model* other_address = other_pool->acquire().get();
+    ASSERT_NE(pool.acquire().get(), other_address);
+    std::thread([&other_pool] {
+        auto handle = other_pool->acquire();
+        handle->set_name("released on another thread");
+    }).join();
+    ASSERT_EQ(other_pool->acquire().get(), other_address);
+    other_pool.reset();
+}
+
+struct Catalog : public json_model::Model {
+    DECLARE_FIELD(items, std::vector<std::unique_ptr<Nested>>);
+    DECLARE_FIELD(index, std::map<std::string, std::unique_ptr<Nested>>);
+
+    PROVIDE_DETAILS(
+        Catalog,
+        items(_, "items"),
+        index(_, "index")
+    )
+};
+
+TEST(pool, nested_models) {
+    json_model::Pool<Catalog> pool;
+    const Nested* item_address;
+    const Nested* index_address;
+    {
+        auto catalog = pool.acquire();
+        ASSERT_TRUE(catalog->from_json(R"({"items":[{"id":1,"values":[1]}],"index":{"a":{"id":2,"values":[]}}})"));
+        item_address = catalog->get_items()[0].get();
+        index_address = catalog->get_index().at("a").get();
+    }
+
+    // Nested models in vectors and maps are reset in place, and are reused by parsing
+    auto catalog = pool.acquire();
+    ASSERT_EQ(catalog->to_json(), R"({"items":[{"id":0,"values":[]}],"index":{"a":{"id":0,"values":[]}}})");
+    ASSERT_TRUE(catalog->from_json(R"({"items":[{"id":3,"values":[2]}],"index":{"b":{"id":4,"values":[]}}})"));
+    ASSERT_EQ(catalog->get_items()[0].get(), item_address);
+    ASSERT_EQ(catalog->get_index().at("b").get(), index_address);
+}
+
+TEST(pool, free_list) {
+    constexpr size_t SIZE = 200;
+    json_model::Pool<Model> pool(SIZE);
+    std::vector<json_model::Pool<Model>::Handle> handles;
+    std::set<const Model*> addresses;
+    for (size_t i = 0; i < SIZE; ++i) {
+        handles.push_back(pool.acquire());
+        addresses.insert(handles.back().get());
+    }
+    ASSERT_EQ(addresses.size(), SIZE);
+
+    // Models released beyond the cache of the slot go to the free list in batches and are acquired again from it
+    for (size_t round = 0; round < 3; ++round) {
+        handles.clear();
+        for (size_t i = 0; i < SIZE; ++i) {
+            handles.push_back(pool.acquire());
+            ASSERT_EQ(addresses.count(handles.back().get()), 1u);
+        }
+    }
+}
+
+TEST(pool, threads) {
+    json_model::Pool<Model> pool(16);
+    constexpr size_t THREADS = 4;
+    constexpr size_t ITERATIONS = 1000;
+
+    // Models are released on other threads, so they move through the shared free list
+    std::vector<std::vector<json_model::Pool<Model>::Handle>> handles(THREADS);
+    std::vector<std::thread> threads;
+    std::atomic<size_t> failures(0);
+    for (size_t i = 0; i < THREADS; ++i) {
+        threads.emplace_back([&pool, &handles, &failures, i] {
+            for (size_t j = 0; j < ITERATIONS; ++j) {
+                auto model = pool.acquire();
+                if (!model->get_name().empty() || !model->from_json(JSON) || model->to_json() != JSON) {
+                    ++failures;
+                }
+                if (j % 3 == 0) {
+                    handles[i].push_back(std::move(model));
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(failures.load(), 0u);
+
+    threads.clear();
+    for (size_t i = 0; i < THREADS; ++i) {
+        threads.emplace_back([&handles, i]() noexcept {
+            handles[(i + 1) % THREADS].clear();
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+} // namespace pool
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace atomic_model {
+
+using pool::Model;
+using pool::JSON;
+
+const std::string OTHER_JSON = R"({"name":"other","price":2.5,"tags":[],"counts":{},"nested":{"id":3,"values":[]},)"
+                               R"("variant":1})";
+
+TEST(atomic_model, publish) {
+    json_model::AtomicModel<Model> config;
+    ASSERT_EQ(config.read()->to_json(), Model().to_json());
+
+    auto model = std::make_unique<Model>();
+    ASSERT_TRUE(model->from_json(JSON));
+    const Model* address = model.get();
+    auto previous = config.publish(std::move(model));
+    ASSERT_EQ(previous->to_json(), Model().to_json());
+    {
+        auto guard = config.read();
+        ASSERT_EQ(guard.get(), address);
+        ASSERT_EQ((*guard).to_json(), JSON);
+    }
+
+    // Failed reload keeps current version
+    ASSERT_THROW(config.reload(R"({"name":1})"), json_model::TypeMismatchError);
+    ASSERT_FALSE(config.reload("{", false));
+    ASSERT_EQ(config.read().get(), address);
+
+    ASSERT_TRUE(config.reload(OTHER_JSON));
+    ASSERT_EQ(config.read()->to_json(), OTHER_JSON);
+    ASSERT_TRUE(config.reload(JSON));
+    ASSERT_EQ(config.read()->to_json(), JSON);
+}
+
+TEST(atomic_model, threads) {
+    json_model::AtomicModel<Model> config;
+    ASSERT_TRUE(config.reload(JSON));
+    constexpr size_t THREADS = 4;
+    constexpr size_t RELOADS = 200;
+
+    // Readers always see a complete version, while it is being replaced
+    std::atomic<bool> stopped(false);
+    std::atomic<size_t> failures(0);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < THREADS; ++i) {
+        threads.emplace_back([&config, &stopped, &failures] {
+            while (!stopped.load()) {
+                auto guard = config.read();
+                const std::string& name = guard->get_name();
+                if (name != "other" && name != "a rather long name to be allocated on heap") {
+                    ++failures;
+                }
+            }
+        });
+    }
+    for (size_t i = 0; i < RELOADS; ++i) {
+        ASSERT_TRUE(config.reload(i % 2 == 0 ? OTHER_JSON : JSON));
+    }
+    stopped = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    ASSERT_EQ(failures.load(), 0u);
+    ASSERT_EQ(config.read()->to_json(), JSON);
+}
+
+} // namespace atomic_model
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace json_model::test_pool
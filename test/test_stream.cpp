@@ -0,0 +1,290 @@
+//
+// Copyright (c) 2020 Andrei Odintsov <forestryks1@gmail.com>
+//
+
+#include <json_model/batch.h>
+#include <json_model/model.h>
+
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <optional>
+#include <sstream>
+#include <string>
+
+namespace json_model::test_stream {
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace sinks {
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(strings, std::vector<std::string>);
+
+    PROVIDE_DETAILS(
+        Model,
+        strings(_, "strings")
+    )
+};
+
+class ChunkSink : public json_model::Sink {
+public:
+    bool write(const char* data, size_t size) noexcept override {
+        EXPECT_LE(size, json_model::OutputStream::BUFFER_SIZE);
+        str += std::string(data, size);
+        chunks++;
+        return true;
+    }
+
+    std::string str;
+    size_t chunks = 0;
+};
+
+class FailingSink : public json_model::Sink {
+public:
+    bool write(const char*, size_t) noexcept override {
+        writes++;
+        return false;
+    }
+
+    size_t writes = 0;
+};
+
+TEST(stream, sinks) {
+    Model model;
+    std::string expected = R"({"strings":[)";
+    for (int i = 0; i < 10000; ++i) {
+        model.get_strings().push_back(std::to_string(i));
+        expected += (i == 0 ? "\"" : ",\"") + std::to_string(i) + "\"";
+    }
+    expected += "]}";
+
+    ASSERT_EQ(model.to_json(), expected);
+
+    ChunkSink chunk_sink;
+    ASSERT_TRUE(model.to_json(chunk_sink));
+    ASSERT_EQ(chunk_sink.str, expected);
+    ASSERT_GT(chunk_sink.chunks, 1u);
+
+    std::ostringstream os;
+    ASSERT_TRUE(model.to_json(os));
+    ASSERT_EQ(os.str(), expected);
+
+    std::FILE* file = std::tmpfile();
+    ASSERT_NE(file, nullptr);
+    ASSERT_TRUE(model.to_json(file));
+    std::rewind(file);
+    std::string from_file(expected.size() + 1, '\0');
+    from_file.resize(std::fread(from_file.data(), 1, from_file.size(), file));
+    std::fclose(file);
+    ASSERT_EQ(from_file, expected);
+
+    FailingSink failing_sink;
+    ASSERT_FALSE(model.to_json(failing_sink));
+    ASSERT_EQ(failing_sink.writes, 1u);
+}
+
+TEST(stream, bulk_write) {
+    std::string str;
+    json_model::StringSink sink(str);
+    json_model::OutputStream stream(sink);
+    std::string small(100, 'a');
+    std::string large(json_model::OutputStream::BUFFER_SIZE * 3, 'b');
+    stream.write(small.data(), small.size());
+    stream.write(large.data(), large.size());
+    stream.Put('c');
+    stream.write(small.data(), small.size());
+    stream.Flush();
+    ASSERT_EQ(str, small + large + "c" + small);
+}
+
+} // namespace sinks
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace batch {
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(id, int);
+
+    PROVIDE_DETAILS(
+        Model,
+        id(_, "id")
+    )
+};
+
+class CountingSink : public json_model::Sink {
+public:
+    bool write(const char* data, size_t size) noexcept override {
+        str += std::string(data, size);
+        return true;
+    }
+
+    bool flush() noexcept override {
+        flushes++;
+        return true;
+    }
+
+    std::string str;
+    size_t flushes = 0;
+};
+
+TEST(stream, batch) {
+    std::vector<Model> models(3);
+    std::vector<std::unique_ptr<Model>> pointers;
+    std::string expected_array = "[";
+    std::string expected_ndjson;
+    for (int i = 0; i < 3; ++i) {
+        models[static_cast<size_t>(i)].set_id(i);
+        pointers.push_back(std::make_unique<Model>());
+        pointers.back()->set_id(i);
+        expected_array += (i == 0 ? "" : ",") + models[static_cast<size_t>(i)].to_json();
+        expected_ndjson += models[static_cast<size_t>(i)].to_json() + "\n";
+    }
+    expected_array += "]";
+
+    CountingSink sink;
+    ASSERT_TRUE(json_model::write_array(models, sink));
+    ASSERT_EQ(sink.str, expected_array);
+    ASSERT_EQ(sink.flushes, 1u);
+
+    sink = CountingSink();
+    ASSERT_TRUE(json_model::write_array(pointers, sink));
+    ASSERT_EQ(sink.str, expected_array);
+
+    sink = CountingSink();
+    ASSERT_TRUE(json_model::write_ndjson(models, sink));
+    ASSERT_EQ(sink.str, expected_ndjson);
+    ASSERT_EQ(sink.flushes, 1u);
+
+    sink = CountingSink();
+    ASSERT_TRUE(json_model::write_ndjson(pointers, sink));
+    ASSERT_EQ(sink.str, expected_ndjson);
+
+    sink = CountingSink();
+    ASSERT_TRUE(json_model::write_array(std::vector<Model>(), sink));
+    ASSERT_EQ(sink.str, "[]");
+    sink = CountingSink();
+    ASSERT_TRUE(json_model::write_ndjson(std::vector<Model>(), sink));
+    ASSERT_EQ(sink.str, "");
+}
+
+struct Item : public json_model::Model {
+    DECLARE_FIELD(id, int);
+    DECLARE_FIELD(name, std::string);
+    DECLARE_FIELD(tags, std::vector<std::string>);
+
+    PROVIDE_DETAILS(
+        Item,
+        id(_, "id"),
+        name(_, "name"),
+        tags(_, "tags")
+    )
+};
+
+struct Entry : public json_model::Model {
+    DECLARE_FIELD(data, std::optional<json_model::Value>);
+
+    PROVIDE_DETAILS(
+        Entry,
+        data(_, "data")
+    )
+};
+
+TEST(stream, parse_array) {
+    std::string json = " [ ";
+    for (int i = 0; i < 5000; ++i) {
+        json += std::string(i == 0 ? "" : " ,\n") + R"({"id":)" + std::to_string(i) + R"(,"name":"a,]\"}[",)" +
+                R"("tags":[")" + std::to_string(i) + R"(","x"]})";
+    }
+    json += "]\n";
+    json_model::ThreadPool thread_pool(3);
+
+    // Elements are found through strings with brackets and separators, and are kept in order
+    std::vector<std::unique_ptr<Item>> pointers;
+    ASSERT_TRUE(json_model::parse_array(json, pointers, thread_pool));
+    ASSERT_EQ(pointers.size(), 5000u);
+    ASSERT_EQ(pointers[4999]->get_id(), 4999);
+    ASSERT_EQ(pointers[0]->get_tags(), (std::vector<std::string>{"0", "x"}));
+    ASSERT_EQ(pointers[1]->get_name(), "a,]\"}[");
+
+    std::vector<Item> models;
+    ASSERT_TRUE(json_model::parse_array(json, models, thread_pool));
+    ASSERT_EQ(models.size(), 5000u);
+    const Item* address = &models[0];
+    ASSERT_TRUE(json_model::parse_array(json, models, thread_pool));
+    ASSERT_EQ(&models[0], address);
+    for (size_t i = 0; i < models.size(); ++i) {
+        ASSERT_EQ(models[i].to_json(), pointers[i]->to_json());
+    }
+
+    std::vector<int> numbers;
+    ASSERT_TRUE(json_model::parse_array("[1, 2,3 ]", numbers, thread_pool));
+    ASSERT_EQ(numbers, (std::vector<int>{1, 2, 3}));
+    ASSERT_TRUE(json_model::parse_array(" []", numbers, thread_pool));
+    ASSERT_TRUE(numbers.empty());
+
+    // The first failed element is reported, as by sequential parsing
+    std::string broken = json;
+    broken.replace(broken.find(R"("id":4000,)"), 9, R"("id":"x")");
+    broken.replace(broken.find(R"("id":3000,)"), 9, R"("id":1.5)");
+    try {
+        json_model::parse_array(broken, models, thread_pool);
+        FAIL() << "Expected exception";
+    } catch (json_model::TypeMismatchError& error) {
+        ASSERT_EQ(error.get_compact(), R"(Type mismatch at 'root[3000]["id"]' (expected: int, actual: number))");
+    }
+    ASSERT_FALSE(json_model::parse_array(broken, models, thread_pool, false));
+
+    // Syntax errors take precedence over schema errors of preceding elements
+    try {
+        json_model::parse_array(R"([{"id":1}, {"id":}])", models, thread_pool);
+        FAIL() << "Expected exception";
+    } catch (json_model::ParseError& error) {
+        ASSERT_EQ(error.get_compact(), "Cannot parse json (offset 17): Invalid value.");
+    }
+
+    // Errors found by the pre-scan or inside elements have the same offset and reason as with sequential parsing
+    const std::pair<std::string, std::string> syntax_errors[] = {
+        {R"([{]}])", "Cannot parse json (offset 2): Missing a name for object member."},
+        {R"([{"id":1}, [}])", "Cannot parse json (offset 12): Invalid value."},
+        {R"([{"id":"1}])", "Cannot parse json (offset 11): Missing a closing quotation mark in string."},
+        {R"([{"id":}, {"id":1})", "Cannot parse json (offset 7): Invalid value."},
+        {R"([1 2])", "Cannot parse json (offset 3): Missing a comma or ']' after an array element."},
+    };
+    for (const auto& [json_str, message] : syntax_errors) {
+        try {
+            json_model::parse_array(json_str, numbers, thread_pool);
+            FAIL() << "Expected exception";
+        } catch (json_model::ParseError& error) {
+            ASSERT_EQ(error.get_compact(), message) << json_str;
+        }
+        ASSERT_FALSE(json_model::parse_array(json_str, numbers, thread_pool, false));
+    }
+    ASSERT_THROW(json_model::parse_array(R"({"id":1})", models, thread_pool), json_model::ParseError);
+    ASSERT_THROW(json_model::parse_array(R"([{"id":1})", models, thread_pool), json_model::ParseError);
+    ASSERT_THROW(json_model::parse_array(R"([{"id":1}] 1)", models, thread_pool), json_model::ParseError);
+    ASSERT_FALSE(json_model::parse_array(R"([{"id":1},])", models, thread_pool, false));
+
+    // Dynamic values keep allocator of their element, while other elements of chunk reuse it
+    std::string entries_json = "[";
+    for (int i = 0; i < 5000; ++i) {
+        entries_json += i == 0 ? "" : ",";
+        entries_json += i % 3 == 0 ? R"({"data":[)" + std::to_string(i) + "]}" : "{}";
+    }
+    entries_json += "]";
+    std::vector<Entry> entries;
+    ASSERT_TRUE(json_model::parse_array(entries_json, entries, thread_pool));
+    ASSERT_EQ(entries.size(), 5000u);
+    for (size_t i = 0; i < entries.size(); ++i) {
+        ASSERT_EQ(entries[i].get_data().has_value(), i % 3 == 0);
+        if (i % 3 == 0) {
+            ASSERT_EQ(entries[i].get_data()->get_value()[0].GetUint64(), i);
+        }
+    }
+}
+
+} // namespace batch
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // namespace json_model::test_stream
@@ -4,8 +4,12 @@
 
 #include <json_model/model.h>
 
+#include <json_model/external/rapidjson/stringbuffer.h>
+
 #include <gtest/gtest.h>
+#include <algorithm>
 #include <functional>
+#include <random>
 #include <string>
 
 namespace json_model::test_to_json {
@@ -463,4 +467,396 @@ TEST(to_json, variant) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace keys {
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(first, std::optional<int>);
+    DECLARE_FIELD(second, int);
+    DECLARE_FIELD(third, std::optional<int>);
+    DECLARE_FIELD(map, std::map<std::string, int>);
+
+    PROVIDE_DETAILS(
+        Model,
+        first(_, "first"),
+        second(_, "quoted \"key\"\n"),
+        third(_, "third"),
+        map(_, "map")
+    )
+};
+
+TEST(to_json, keys) {
+    Model model;
+    model.set_second(1);
+    model.get_map()["\\"] = 2;
+    ASSERT_EQ(model.to_json(), R"({"quoted \"key\"\n":1,"map":{"\\":2}})");
+    model.set_first(0);
+    model.set_third(2);
+    ASSERT_EQ(model.to_json(), R"({"first":0,"quoted \"key\"\n":1,"third":2,"map":{"\\":2}})");
+}
+
+} // namespace keys
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace json_size {
+
+struct InnerModel : public json_model::Model {
+    DECLARE_FIELD(value, std::optional<int64_t>);
+
+    PROVIDE_DETAILS(
+        InnerModel,
+        value(_, "value")
+    )
+};
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(bool_field, bool);
+    DECLARE_FIELD(int_field, int);
+    DECLARE_FIELD(uint64_field, uint64_t);
+    DECLARE_FIELD(string_field, std::string);
+    DECLARE_FIELD(null_field, std::nullptr_t);
+    DECLARE_FIELD(optional_field, std::optional<std::string>);
+    DECLARE_FIELD(inner, std::unique_ptr<InnerModel>);
+    DECLARE_FIELD(vector, std::vector<std::variant<int, std::string>>);
+    DECLARE_FIELD(map, std::map<std::string, std::vector<unsigned>>);
+    DECLARE_FIELD(double_field, std::optional<double>);
+
+    PROVIDE_DETAILS(
+        Model,
+        bool_field(_, "bool"),
+        int_field(_, "int"),
+        uint64_field(_, "uint64"),
+        string_field(_, "string\t"),
+        null_field(_, "null"),
+        optional_field(_, "optional"),
+        inner(_, "inner"),
+        vector(_, "vector"),
+        map(_, "map"),
+        double_field(_, "double")
+    )
+};
+
+TEST(to_json, json_size) {
+    Model model;
+    ASSERT_EQ(model.json_size(), model.to_json().size());
+
+    model.set_bool_field(true);
+    model.set_int_field(INT32_MIN);
+    model.set_uint64_field(UINT64_MAX);
+    model.set_string_field(std::string("\"\\/\b\f\n\r\t\x01\x1f\x7f\0 \xd0\xbf", 15));
+    model.set_optional_field("");
+    model.get_inner()->set_value(-10);
+    model.set_vector(std::vector<std::variant<int, std::string>>{0, "1", -239, "\n"});
+    model.get_map()["\x02"] = {1, 10, 100};
+    model.get_map()["key"] = {};
+    ASSERT_EQ(model.json_size(), model.to_json().size());
+
+    model.set_double_field(-1.2345678901234567e21);
+    ASSERT_GE(model.json_size(), model.to_json().size());
+    model.set_double_field(0.5);
+    ASSERT_GE(model.json_size(), model.to_json().size());
+}
+
+} // namespace json_size
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace doubles {
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(value, double);
+    DECLARE_FIELD(coordinates, std::vector<double>);
+    DECLARE_FIELD(rates, std::vector<double>);
+
+    PROVIDE_DETAILS(
+        Model,
+        value(_, "value"),
+        coordinates(_, "coordinates", json_model::max_decimal_places(6)),
+        rates(_, "rates", json_model::max_decimal_places(8))
+    )
+};
+
+TEST(to_json, doubles) {
+    Model model;
+    model.set_coordinates(std::vector<double>{-0.118092123, 51.5098651, 0.1, 3, 1e-7, -1e-7, 1e20, 0.0000015});
+    ASSERT_EQ(model.to_json(),
+              R"({"value":0.0,"coordinates":[-0.118092,51.509865,0.1,3.0,0.0,-0.0,1e+20,0.000002],"rates":[]})");
+
+    // Values in exponent form and large values are rounded too
+    model.get_coordinates().clear();
+    model.set_rates(std::vector<double>{1.2346e-05, -3.14159265e-9, 2.5e-300, 1234567890123456.8, 1e15 + 0.125});
+    ASSERT_EQ(model.to_json(),
+              R"({"value":0.0,"coordinates":[],"rates":[0.00001235,-0.0,0.0,1234567890123456.8,1000000000000000.1]})");
+    ASSERT_LE(model.to_json().size(), model.json_size());
+
+    for (double value : {0.1, 3.0, -2.5, 1.0 / 3, 1e21, 5e-324, 1.7976931348623157e308, -0.0000012345678901234567}) {
+        model.set_value(value);
+        Model parsed;
+        ASSERT_TRUE(parsed.from_json(model.to_json()));
+        ASSERT_EQ(parsed.get_value(), value);
+        ASSERT_LE(model.to_json().size(), model.json_size());
+    }
+}
+
+} // namespace doubles
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace strings {
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(strings, std::map<std::string, std::string>);
+
+    PROVIDE_DETAILS(
+        Model,
+        strings(_, "strings")
+    )
+};
+
+TEST(to_json, strings) {
+    std::vector<json_model::find_escape_t> implementations = {json_model::find_escape_scalar, json_model::find_escape};
+#ifdef JSON_MODEL_SSE2
+    implementations.push_back(json_model::find_escape_sse2);
+#endif
+#ifdef JSON_MODEL_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        implementations.push_back(json_model::find_escape_avx2);
+    }
+#endif
+
+    Model model;
+    std::mt19937 rng(239);
+    const std::string special = std::string("\"\\\n\x01\x1f\x7f\xff /\0", 10);
+    for (size_t length = 0; length < 200; ++length) {
+        for (size_t escapes = 0; escapes < 3; ++escapes) {
+            std::string str(length, 'a');
+            for (size_t i = 0; i < length; ++i) {
+                str[i] = static_cast<char>('a' + rng() % 26);
+            }
+            for (size_t i = 0; i < escapes && length != 0; ++i) {
+                str[rng() % length] = special[rng() % special.size()];
+            }
+
+            const char* expected = std::find_if(str.data(), str.data() + str.size(), json_model::needs_escape);
+            for (auto implementation : implementations) {
+                ASSERT_EQ(implementation(str.data(), str.data() + str.size()), expected);
+            }
+            model.get_strings()[str] = str;
+        }
+    }
+
+    rapidjson::StringBuffer buffer;
+    rapidjson::Writer<rapidjson::StringBuffer> writer(buffer);
+    writer.StartObject();
+    writer.Key("strings");
+    writer.StartObject();
+    for (const auto& item : model.get_strings()) {
+        writer.Key(item.first.data(), static_cast<rapidjson::SizeType>(item.first.size()));
+        writer.String(item.second.data(), static_cast<rapidjson::SizeType>(item.second.size()));
+    }
+    writer.EndObject();
+    writer.EndObject();
+    std::string expected(buffer.GetString(), buffer.GetSize());
+    ASSERT_EQ(model.to_json(), expected);
+    ASSERT_EQ(model.json_size(), expected.size());
+}
+
+} // namespace strings
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cached_model {
+
+struct LeafModel : public json_model::CachedModel {
+    DECLARE_FIELD(value, int);
+
+    PROVIDE_DETAILS(
+        LeafModel,
+        value(_, "value")
+    )
+};
+
+struct InnerModel : public json_model::CachedModel {
+    DECLARE_FIELD(leaves, std::vector<std::unique_ptr<LeafModel>>);
+
+    PROVIDE_DETAILS(
+        InnerModel,
+        leaves(_, "leaves")
+    )
+};
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(first, std::unique_ptr<InnerModel>);
+    DECLARE_FIELD(second, std::unique_ptr<InnerModel>);
+
+    PROVIDE_DETAILS(
+        Model,
+        first(_, "first"),
+        second(_, "second")
+    )
+};
+
+TEST(to_json, cached_model) {
+    Model model;
+    for (int i = 0; i < 2; ++i) {
+        model.get_first()->get_leaves().push_back(std::make_unique<LeafModel>());
+        model.get_second()->get_leaves().push_back(std::make_unique<LeafModel>());
+    }
+    ASSERT_EQ(model.to_json(), R"({"first":{"leaves":[{"value":0},{"value":0}]},"second":{"leaves":[{"value":0},{"value":0}]}})");
+
+    model.get_first()->get_leaves()[1]->set_value(1);
+    ASSERT_EQ(model.to_json(), R"({"first":{"leaves":[{"value":0},{"value":1}]},"second":{"leaves":[{"value":0},{"value":0}]}})");
+
+    // Modifications through kept pointers mark cached ancestors dirty too
+    LeafModel* leaf = model.get_second()->get_leaves()[0].get();
+    ASSERT_EQ(model.to_json(), R"({"first":{"leaves":[{"value":0},{"value":1}]},"second":{"leaves":[{"value":0},{"value":0}]}})");
+    leaf->set_value(2);
+    ASSERT_EQ(model.to_json(), R"({"first":{"leaves":[{"value":0},{"value":1}]},"second":{"leaves":[{"value":2},{"value":0}]}})");
+    ASSERT_EQ(model.json_size(), model.to_json().size());
+
+    // Model moved out of its parent outlives it
+    auto inner = std::make_unique<InnerModel>();
+    inner->get_leaves().push_back(std::make_unique<LeafModel>());
+    ASSERT_EQ(inner->to_json(), R"({"leaves":[{"value":0}]})");
+    auto leaf_owner = std::move(inner->get_leaves()[0]);
+    inner.reset();
+    leaf_owner->set_value(4);
+    ASSERT_EQ(leaf_owner->to_json(), R"({"value":4})");
+
+    ASSERT_TRUE(model.from_json(R"({"first":{"leaves":[]},"second":{"leaves":[{"value":3}]}})"));
+    ASSERT_EQ(model.to_json(), R"({"first":{"leaves":[]},"second":{"leaves":[{"value":3}]}})");
+}
+
+struct Point : public json_model::CachedModel {
+    DECLARE_FIELD(x, double);
+
+    PROVIDE_DETAILS(
+        Point,
+        x(_, "x")
+    )
+};
+
+struct Track : public json_model::CachedModel {
+    DECLARE_FIELD(points, std::vector<std::unique_ptr<Point>>);
+
+    PROVIDE_DETAILS(
+        Track,
+        points(_, "points")
+    )
+};
+
+TEST(to_json, cached_model_size) {
+    Track track;
+    for (int i = 0; i < 3; ++i) {
+        track.get_points().push_back(std::make_unique<Point>());
+        track.get_points().back()->set_x(0.5);
+    }
+    // Fields are walked while models are dirty, and size of doubles is overestimated
+    const size_t estimate = track.json_size();
+    const std::string json = track.to_json();
+    ASSERT_GT(estimate, json.size());
+
+    // Clean models report size of their cache, so clean points aren't walked again
+    ASSERT_EQ(track.json_size(), json.size());
+    track.mark_dirty();
+    ASSERT_EQ(track.json_size(), json.size());
+    track.get_points()[1]->set_x(0.25);
+    ASSERT_EQ(track.json_size(), json.size() + json_model::DOUBLE_MAX_JSON_SIZE - 3);
+    ASSERT_EQ(track.to_json(), R"({"points":[{"x":0.5},{"x":0.25},{"x":0.5}]})");
+    ASSERT_EQ(track.json_size(), track.to_json().size());
+}
+
+} // namespace cached_model
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace parallel {
+
+struct InnerModel : public json_model::Model {
+    DECLARE_FIELD(value, double);
+    DECLARE_FIELD(name, std::string);
+
+    PROVIDE_DETAILS(
+        InnerModel,
+        value(_, "value"),
+        name(_, "name")
+    )
+};
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(vector, std::vector<std::unique_ptr<InnerModel>>);
+    DECLARE_FIELD(map, std::map<std::string, std::vector<int>>);
+    DECLARE_FIELD(doubles, std::vector<double>);
+
+    PROVIDE_DETAILS(
+        Model,
+        vector(_, "vector"),
+        map(_, "map"),
+        doubles(_, "doubles", json_model::max_decimal_places(2))
+    )
+};
+
+TEST(to_json, parallel) {
+    json_model::ThreadPool thread_pool(3);
+    for (size_t size : std::vector<size_t>{0, 1, 1000, 50000}) {
+        Model model;
+        for (size_t i = 0; i < size; ++i) {
+            auto ptr = std::make_unique<InnerModel>();
+            ptr->set_value(static_cast<double>(i) / 7).set_name(std::to_string(i));
+            model.get_vector().push_back(std::move(ptr));
+            model.get_map()[std::to_string(i)] = {static_cast<int>(i), 1, 2};
+            model.get_doubles().push_back(static_cast<double>(i) / 3);
+        }
+
+        std::string expected = model.to_json();
+        ASSERT_EQ(model.to_json(thread_pool), expected);
+        ASSERT_EQ(model.to_json(thread_pool, 1), expected);
+        ASSERT_EQ(model.to_json(thread_pool, 1000), expected);
+    }
+}
+
+} // namespace parallel
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace final_models {
+
+struct Leaf final : public json_model::Model {
+    DECLARE_FIELD(name, std::string);
+    DECLARE_FIELD(values, std::vector<int>);
+
+    PROVIDE_DETAILS(
+        Leaf,
+        name(_, "name"),
+        values(_, "values")
+    )
+};
+
+struct Model final : public json_model::Model {
+    DECLARE_FIELD(leaf, std::unique_ptr<Leaf>);
+    DECLARE_FIELD(leaves, std::map<std::string, std::unique_ptr<Leaf>>);
+
+    PROVIDE_DETAILS(
+        Model,
+        leaf(_, "leaf"),
+        leaves(_, "leaves")
+    )
+};
+
+TEST(to_json, final_models) {
+    const std::string json = R"({"leaf":{"name":"a","values":[1,2]},"leaves":{"b":{"name":"b","values":[]}}})";
+    Model model;
+    ASSERT_TRUE(model.from_json(json));
+    ASSERT_EQ(model.to_json(), json);
+    ASSERT_EQ(model.json_size(), json.size());
+
+    Model other;
+    ASSERT_TRUE(other.from_msgpack(model.to_msgpack()));
+    ASSERT_EQ(json_model::diff(model, other), "{}");
+}
+
+} // namespace final_models
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // namespace json_model::test_to_json
@@ -44,6 +44,11 @@ TEST(traits, traits) {
     static_assert(json_model::is_vector_v<std::vector<std::unique_ptr<Model>>>);
     static_assert(json_model::is_vector_v<std::vector<std::vector<std::unique_ptr<Model>>>>);
     static_assert(!json_model::is_vector_v<std::vector<Model>>);
+    static_assert(json_model::is_vector_v<std::array<int, 2>>);
+    static_assert(json_model::is_vector_v<json_model::SmallVector<std::unique_ptr<Model>, 4>>);
+    static_assert(json_model::is_array_v<std::array<std::string, 3>>);
+    static_assert(!json_model::is_array_v<std::vector<int>>);
+    static_assert(!json_model::is_vector_v<std::array<Model, 2>>);
 
     static_assert(json_model::is_map_v<std::map<std::string, int>>);
     static_assert(json_model::is_map_v<std::map<std::string, std::unique_ptr<Model>>>);
@@ -97,4 +102,71 @@ TEST(traits, traits) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+namespace for_each_field {
+
+struct Nested : public json_model::Model {
+    DECLARE_FIELD(id, int);
+
+    PROVIDE_DETAILS(
+        Nested,
+        id(_, "id")
+    )
+};
+
+struct Model : public json_model::Model {
+    DECLARE_FIELD(name, std::string);
+    DECLARE_FIELD(count, int);
+    DECLARE_FIELD(price, double);
+    DECLARE_FIELD(nested, std::unique_ptr<Nested>);
+    DECLARE_FIELD(optional, std::optional<std::string>);
+
+    PROVIDE_DETAILS(
+        Model,
+        name(_, "name"),
+        count(_, "count"),
+        price(_, "price", json_model::max_decimal_places(2)),
+        nested(_, "nested_model"),
+        optional(_, "optional")
+    )
+};
+
+TEST(traits, for_each_field) {
+    Model model;
+    model.set_name("name").set_count(3).set_price(2.5);
+    model.get_nested()->set_id(7);
+
+    std::vector<std::string> names;
+    int64_t sum = 0;
+    const Model& const_model = model;
+    json_model::for_each_field(const_model, [&](const char* name, auto& value) {
+        static_assert(std::is_const_v<std::remove_reference_t<decltype(value)>>);
+        using T = std::decay_t<decltype(value)>;
+        names.emplace_back(name);
+        if constexpr (std::is_same_v<T, int>) {
+            sum += value;
+        } else if constexpr (std::is_same_v<T, std::unique_ptr<Nested>>) {
+            json_model::for_each_field(*value, [&sum](const char*, const int& id) {
+                sum += id;
+            });
+        }
+    });
+    ASSERT_EQ(names, (std::vector<std::string>{"name", "count", "price", "nested_model", "optional"}));
+    ASSERT_EQ(sum, 10);
+
+    json_model::for_each_field(model, [](const char*, auto& value) {
+        using T = std::decay_t<decltype(value)>;
+        if constexpr (std::is_same_v<T, std::string>) {
+            value += "!";
+        } else if constexpr (std::is_same_v<T, std::optional<std::string>>) {
+            value = "set";
+        }
+    });
+    ASSERT_EQ(model.get_name(), "name!");
+    ASSERT_EQ(model.get_optional(), "set");
+}
+
+} // namespace for_each_field
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // namespace json_model::test_traits